@@ -0,0 +1,266 @@
+#include <RGBWWCtrl.h>
+
+
+void AnimationProgram::clear() {
+    _numSteps = 0;
+}
+
+bool AnimationProgram::addStep(const Step& step) {
+    if (_numSteps >= _maxSteps)
+        return false;
+
+    BinaryFrameWriter frame(_data + _numSteps * _stepSize, _stepSize);
+    frame.put8(step.op);
+    frame.put8(step.flags);
+    frame.put8(step.mask);
+    frame.put8(0);
+    frame.put32(step.time);
+    if (step.flags & FlagRaw) {
+        frame.putPacked10(step.vals[0], step.vals[1], step.vals[2], step.vals[3], step.vals[4]);
+        frame.put8(0);
+    }
+    else {
+        for(int i=0; i < 4; ++i)
+            frame.put16(step.vals[i]);
+    }
+
+    ++_numSteps;
+    return true;
+}
+
+bool AnimationProgram::getStep(int idx, Step& step) const {
+    if (idx < 0 || idx >= _numSteps)
+        return false;
+
+    BinaryFrameReader frame(_data + idx * _stepSize, _stepSize);
+    step.op = frame.get8();
+    step.flags = frame.get8();
+    step.mask = frame.get8();
+    frame.get8();
+    step.time = frame.get32();
+    if (step.flags & FlagRaw) {
+        frame.getPacked10(step.vals);
+    }
+    else {
+        for(int i=0; i < 4; ++i)
+            step.vals[i] = frame.get16();
+        step.vals[4] = 0;
+    }
+    return frame.isValid();
+}
+
+bool AnimationProgram::save(const String& name) const {
+    uint8_t header[_headerSize] = { 'A', 'P', _version, static_cast<uint8_t>(_numSteps) };
+
+    file_t file = fileOpen(getFileName(name), eFO_CreateNewAlways | eFO_WriteOnly);
+    if (file < 0)
+        return false;
+
+    const int len = _numSteps * _stepSize;
+    const bool ok = fileWrite(file, header, sizeof(header)) == sizeof(header) &&
+            fileWrite(file, _data, len) == len;
+    fileClose(file);
+    return ok;
+}
+
+bool AnimationProgram::load(const String& name) {
+    clear();
+
+    const String fileName = getFileName(name);
+    if (!fileExist(fileName))
+        return false;
+
+    // read binary, String copies would stop at the first 0 byte
+    file_t file = fileOpen(fileName, eFO_ReadOnly);
+    if (file < 0)
+        return false;
+
+    uint8_t header[_headerSize];
+    if (fileRead(file, header, sizeof(header)) != sizeof(header) || header[0] != 'A' || header[1] != 'P' || header[2] != _version) {
+        debug_e("AnimationProgram::load: %s is not a valid program\n", fileName.c_str());
+        fileClose(file);
+        return false;
+    }
+
+    const int numSteps = header[3];
+    const int len = numSteps * _stepSize;
+    uint8_t extra;
+    const bool ok = numSteps <= _maxSteps && fileRead(file, _data, len) == len && fileRead(file, &extra, 1) <= 0;
+    fileClose(file);
+    if (!ok) {
+        debug_e("AnimationProgram::load: %s has a bad size\n", fileName.c_str());
+        return false;
+    }
+
+    _numSteps = numSteps;
+    return true;
+}
+
+void AnimationProgram::remove(const String& name) {
+    fileDelete(getFileName(name));
+}
+
+bool AnimationProgram::isValidName(const String& name) {
+    if (name.length() == 0 || name.length() > _maxNameLen)
+        return false;
+
+    for(unsigned int i=0; i < name.length(); ++i) {
+        const char c = name[i];
+        const bool valid = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '-';
+        if (!valid)
+            return false;
+    }
+    return true;
+}
+
+String AnimationProgram::getFileName(const String& name) {
+    return "anim_" + name;
+}
+
+void AnimationProgram::list(Vector<String>& names) {
+    Vector<String> files = fileList();
+    for(unsigned int i=0; i < files.count(); ++i) {
+        if (files[i].startsWith("anim_"))
+            names.add(files[i].substring(5));
+    }
+}
+
+////////////////////////////////////////
+
+bool AnimationPlayer::play(const String& name, String& error, int firstStep) {
+    stop();
+
+    if (!AnimationProgram::isValidName(name) || !_program.load(name)) {
+        error = "Unknown animation";
+        return false;
+    }
+
+    _name = name;
+    _pc = (firstStep >= 0 && firstStep < _program.getNumSteps()) ? firstStep : 0;
+    _ended = false;
+    memset(_loopCounters, 0, sizeof(_loopCounters));
+    _seqFinished = _seqQueued;
+    _playing = true;
+
+    if (!queueNext(true)) {
+        _playing = false;
+        error = "Animation has no color steps";
+        return false;
+    }
+    process();
+    return true;
+}
+
+void AnimationPlayer::stop() {
+    _playing = false;
+    _program.clear();
+}
+
+int AnimationPlayer::getCurrentStep() const {
+    const int step = _pc - static_cast<int>(_seqQueued - _seqFinished);
+    return step >= 0 ? step : 0;
+}
+
+bool AnimationPlayer::onAnimationFinished(const String& name) {
+    if (name.length() < 2 || name[0] != _stepNamePrefix)
+        return false;
+
+    // every channel reports the step, only the first one counts
+    const uint32_t seq = strtoul(name.c_str() + 1, nullptr, 10);
+    if (_playing && static_cast<int32_t>(seq - _seqFinished) > 0)
+        _seqFinished = seq;
+    return true;
+}
+
+void AnimationPlayer::process() {
+    if (!_playing)
+        return;
+
+    while (!_ended && _seqQueued - _seqFinished < _queueAhead) {
+        if (!queueNext(false))
+            break;
+    }
+
+    if (_ended && _seqFinished == _seqQueued) {
+        _playing = false;
+        app.rgbwwctrl.addFinishedAnimation(_name, false);
+    }
+}
+
+bool AnimationPlayer::queueNext(bool first) {
+    AnimationProgram::Step step;
+
+    // bounded, so loops without color steps cannot hang the controller
+    for(int guard=0; guard < 2 * AnimationProgram::_maxSteps; ++guard) {
+        if (!_program.getStep(_pc, step)) {
+            _ended = true;
+            return false;
+        }
+
+        if (step.op != AnimationProgram::OpLoop)
+            break;
+
+        const uint16_t count = step.vals[1];
+        if (count == 0 || _loopCounters[_pc] < count) {
+            ++_loopCounters[_pc];
+            _pc = step.vals[0];
+        }
+        else {
+            _loopCounters[_pc] = 0;
+            ++_pc;
+        }
+    }
+
+    if (step.op == AnimationProgram::OpLoop) {
+        _ended = true;
+        return false;
+    }
+    ++_pc;
+
+    const QueuePolicy queue = first ? QueuePolicy::Single : QueuePolicy::Back;
+    char name[12] = { _stepNamePrefix };
+    ultoa(++_seqQueued, name + 1, 10);
+    _stepName = name;
+    if (queueStep(step, queue, _stepName))
+        return true;
+
+    // queue full: retry with the next tick
+    --_seqQueued;
+    --_pc;
+    return false;
+}
+
+bool AnimationPlayer::queueStep(const AnimationProgram::Step& step, QueuePolicy queue, const String& name) {
+    APPLedCtrl& ctrl = app.rgbwwctrl;
+
+    if (step.op == AnimationProgram::OpBlink) {
+        ctrl.blink(RGBWWLed::ChannelList(), step.time, queue, false, name);
+        return true;
+    }
+
+    if (step.flags & AnimationProgram::FlagRaw) {
+        RequestChannelOutput raw;
+        AbsOrRelValue* pVals[5] = { &raw.r, &raw.g, &raw.b, &raw.ww, &raw.cw };
+        for(int i=0; i < 5; ++i) {
+            if (step.mask & (1 << i))
+                *pVals[i] = AbsOrRelValue(step.vals[i]);
+        }
+
+        if (step.op == AnimationProgram::OpFade)
+            return ctrl.fadeRAW(raw, RampTimeOrSpeed(step.time), queue, false, name);
+        return ctrl.setRAW(raw, step.time, queue, false, name);
+    }
+
+    RequestHSVCT hsv;
+    AbsOrRelValue* pVals[4] = { &hsv.h, &hsv.s, &hsv.v, &hsv.ct };
+    for(int i=0; i < 4; ++i) {
+        if (step.mask & (1 << i))
+            *pVals[i] = AbsOrRelValue(step.vals[i]);
+    }
+
+    if (step.op == AnimationProgram::OpFade) {
+        const int direction = (step.flags & AnimationProgram::FlagReverse) ? 0 : 1;
+        return ctrl.fadeHSV(hsv, RampTimeOrSpeed(step.time), direction, queue, false, name);
+    }
+    return ctrl.setHSV(hsv, step.time, queue, false, name);
+}
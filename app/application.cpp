@@ -134,6 +134,8 @@ bool Application::delayedCMD(String cmd, int delay) {
         _systimer.initializeMs(delay, TimerDelegate(&Application::reset, this)).startOnce();
     } else if (cmd.equals("restart")) {
         _systimer.initializeMs(delay, TimerDelegate(&Application::restart, this)).startOnce();
+    } else if (cmd.equals("apply_network")) {
+        _systimer.initializeMs(delay, TimerDelegate(&Application::applyNetworkConfig, this)).startOnce();
     } else if (cmd.equals("stopap")) {
         network.stopAp(2000);
     } else if (cmd.equals("forget_wifi")) {
@@ -149,6 +151,53 @@ bool Application::delayedCMD(String cmd, int delay) {
     return true;
 }
 
+// hot applies changed settings sections (ApplicationSettings::getChangedSections)
+void Application::applyConfig(uint32_t sections) {
+    if (sections & (1 << ApplicationSettings::SectionColor)) {
+        debug_i("Application::applyConfig color");
+        if (rgbwwctrl.setup()) {
+            rgbwwctrl.refresh();
+            rgbwwctrl.wake();
+        }
+    }
+
+    if (sections & (1 << ApplicationSettings::SectionEvents)) {
+        if (cfg.events.server_enabled && !eventserver.isRunning()) {
+            debug_i("Application::applyConfig starting event server");
+            eventserver.start();
+        }
+        else if (!cfg.events.server_enabled && eventserver.isRunning()) {
+            debug_i("Application::applyConfig stopping event server");
+            eventserver.stop();
+        }
+    }
+
+    // topics, credentials and the client id are only used when connecting
+    const uint32_t mqttSections = (1 << ApplicationSettings::SectionMqtt) | (1 << ApplicationSettings::SectionSync) |
+            (1 << ApplicationSettings::SectionGeneral);
+    if (sections & (1 << ApplicationSettings::SectionSync)) {
+        rgbwwctrl.setupStepSync();
+        if (WifiStation.isConnected())
+            syncudp.start();
+    }
+
+    if (sections & mqttSections) {
+        debug_i("Application::applyConfig mqtt");
+        mqttclient.stop();
+        mqttclient.init();
+        if (cfg.network.mqtt.enabled && WifiStation.isConnected())
+            mqttclient.start();
+    }
+
+    rgbwwctrl.setupSchedule();
+}
+
+void Application::applyNetworkConfig() {
+    debug_i("Application::applyNetworkConfig");
+    network.applyIpConfig();
+    network.applyApConfig();
+}
+
 void Application::mountfs(int slot) {
     debug_i("Application::mountfs rom slot: %i", slot);
     if (slot == 0) {
@@ -191,6 +240,13 @@ void Application::onCommandRelay(const String& method, const JsonObject& params)
     mqttclient.publishCommand(method, params);
 }
 
+void Application::onCommandRelay(const String& method, const String& paramsJson) {
+    if (!cfg.sync.cmd_master_enabled)
+        return;
+
+    mqttclient.publishCommand(method, paramsJson);
+}
+
 uint32_t Application::getUptime() {
     return _uptimeMinutes * 60u;
 }
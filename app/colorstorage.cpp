@@ -0,0 +1,199 @@
+#include <RGBWWCtrl.h>
+
+
+uint32_t ColorStorage::getAddress(uint32_t slot) {
+    return _firstSector * SPI_FLASH_SEC_SIZE + slot * sizeof(Record);
+}
+
+uint16_t ColorStorage::calcChecksum(const Record& record) {
+    // Fletcher-16 over everything behind the checksum
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(&record.seq);
+    const uint8_t* pEnd = reinterpret_cast<const uint8_t*>(&record) + sizeof(Record);
+    uint16_t sum1 = record.magic;
+    uint16_t sum2 = sum1;
+    for(; pData < pEnd; ++pData) {
+        sum1 = (sum1 + *pData) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+bool ColorStorage::isErased(const Record& record) {
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(&record);
+    for(size_t i=0; i < sizeof(Record); ++i) {
+        if (pData[i] != 0xff)
+            return false;
+    }
+    return true;
+}
+
+bool ColorStorage::checkArea() {
+    const uint32_t start = _firstSector * SPI_FLASH_SEC_SIZE;
+    const uint32_t end = start + _numSectors * SPI_FLASH_SEC_SIZE;
+
+#if defined(RBOOT_SPIFFS_0) && defined(SPIFF_SIZE)
+    static_assert(_firstSector * SPI_FLASH_SEC_SIZE >= RBOOT_SPIFFS_0 + SPIFF_SIZE ||
+            (_firstSector + _numSectors) * SPI_FLASH_SEC_SIZE <= RBOOT_SPIFFS_0,
+            "ColorStorage sectors overlap SPIFFS 0");
+#endif
+#if defined(RBOOT_SPIFFS_1) && defined(SPIFF_SIZE)
+    static_assert(_firstSector * SPI_FLASH_SEC_SIZE >= RBOOT_SPIFFS_1 + SPIFF_SIZE ||
+            (_firstSector + _numSectors) * SPI_FLASH_SEC_SIZE <= RBOOT_SPIFFS_1,
+            "ColorStorage sectors overlap SPIFFS 1");
+#endif
+
+    // the rom addresses are only known at runtime (rBoot config sector)
+    rboot_config bootconf = rboot_get_config();
+    for(uint8_t i=0; i < bootconf.count && i < MAX_ROMS; ++i) {
+        const uint32_t rom = bootconf.roms[i];
+        // a rom may use everything up to the next 1MB boundary (big flash)
+        const uint32_t romEnd = (rom & ~0xfffff) + 0x100000;
+        if (start < romEnd && rom < end) {
+            debug_e("ColorStorage: sectors %x-%x overlap rom %d at %x, using %s", start, end, i, rom, APP_COLOR_FILE);
+            return false;
+        }
+    }
+    return true;
+}
+
+void ColorStorage::scan() {
+    _scanned = true;
+    _hasRecord = false;
+    _nextSlot = 0;
+
+    _usable = checkArea();
+    if (!_usable)
+        return;
+
+    Record record;
+    for(uint32_t slot=0; slot < _numRecords; ++slot) {
+        flashmem_read(&record, getAddress(slot), sizeof(Record));
+        if (record.magic != _magic || record.version != _version || record.checksum != calcChecksum(record))
+            continue;
+
+        if (!_hasRecord || static_cast<int32_t>(record.seq - _seq) > 0) {
+            _hasRecord = true;
+            _seq = record.seq;
+            _nextSlot = (slot + 1) % _numRecords;
+            _saved.h = record.h;
+            _saved.s = record.s;
+            _saved.v = record.v;
+            _saved.ct = record.ct;
+        }
+    }
+}
+
+bool ColorStorage::loadFile() {
+    if (!fileExist(APP_COLOR_FILE))
+        return false;
+
+    StaticJsonBuffer < 72 > jsonBuffer;
+    String jsonString = fileGetContent(APP_COLOR_FILE);
+    JsonObject& root = jsonBuffer.parseObject(jsonString);
+    if (!root.success())
+        return false;
+
+    current.h = root["h"];
+    current.s = root["s"];
+    current.v = root["v"];
+    current.ct = root["ct"];
+    return true;
+}
+
+void ColorStorage::saveFile() {
+    DynamicJsonBuffer jsonBuffer;
+    JsonObject& root = jsonBuffer.createObject();
+    root["h"] = current.h;
+    root["s"] = current.s;
+    root["v"] = current.v;
+    root["ct"] = current.ct;
+    String rootString;
+    root.printTo(rootString);
+    fileSetContent(APP_COLOR_FILE, rootString);
+}
+
+bool ColorStorage::migrate() {
+    if (!loadFile())
+        return false;
+
+    // the file is only dropped once the color is safe in flash
+    debug_i("ColorStorage: migrating %s\n", APP_COLOR_FILE);
+    if (saveRecord())
+        fileDelete(APP_COLOR_FILE);
+    return true;
+}
+
+void ColorStorage::load(bool print) {
+    scan();
+    if (_hasRecord)
+        current = _saved;
+    else if (_usable)
+        migrate();
+    else
+        loadFile();
+
+    if (print)
+        Serial.printf("ColorStorage: h %d s %d v %d ct %d (seq %u)\n", current.h, current.s, current.v, current.ct, _seq);
+}
+
+void ColorStorage::save(bool print) {
+    debug_d("Saving ColorStorage to flash...");
+    if (!_scanned)
+        scan();
+
+    if (!_usable) {
+        saveFile();
+        return;
+    }
+
+    if (_hasRecord && current == _saved)
+        return;
+
+    if (saveRecord() && print)
+        Serial.printf("ColorStorage: saved (seq %u)\n", _seq);
+}
+
+bool ColorStorage::saveRecord() {
+    uint32_t slot = _nextSlot;
+    if (slot % _recordsPerSector != 0) {
+        // a slot that is not erased (e.g. interrupted write): continue in the next sector
+        Record existing;
+        flashmem_read(&existing, getAddress(slot), sizeof(Record));
+        if (!isErased(existing))
+            slot = ((slot / _recordsPerSector + 1) % _numSectors) * _recordsPerSector;
+    }
+
+    if (slot % _recordsPerSector == 0)
+        flashmem_erase_sector(_firstSector + slot / _recordsPerSector);
+
+    Record record;
+    record.magic = _magic;
+    record.version = _version;
+    record.seq = _hasRecord ? _seq + 1 : 0;
+    record.h = current.h;
+    record.s = current.s;
+    record.v = current.v;
+    record.ct = current.ct;
+    record.checksum = calcChecksum(record);
+
+    flashmem_write(&record, getAddress(slot), sizeof(Record));
+    _nextSlot = (slot + 1) % _numRecords;
+
+    Record written;
+    flashmem_read(&written, getAddress(slot), sizeof(Record));
+    if (memcmp(&written, &record, sizeof(Record)) != 0) {
+        debug_e("ColorStorage: writing slot %u failed\n", slot);
+        return false;
+    }
+
+    _hasRecord = true;
+    _seq = record.seq;
+    _saved = current;
+    return true;
+}
+
+bool ColorStorage::exist() {
+    if (!_scanned)
+        scan();
+    return _hasRecord || fileExist(APP_COLOR_FILE);
+}
@@ -0,0 +1,116 @@
+#include <RGBWWCtrl.h>
+
+
+void ColorSyncBuffer::reset() {
+    _numSamples = 0;
+    _intervalSteps = 0;
+    _hasLast = false;
+}
+
+void ColorSyncBuffer::onSample(uint32_t stepsLocal, uint32_t stepsMaster, Mode mode, const int vals[5]) {
+    if (_numSamples > 0) {
+        const int32_t gap = static_cast<int32_t>(stepsMaster - _samples[_numSamples - 1].steps);
+        if (mode != _mode || gap <= 0 || gap > _maxGapSteps) {
+            debug_d("ColorSyncBuffer::onSample: reset (gap %d)\n", gap);
+            reset();
+        }
+    }
+
+    // the offset follows the latest arriving sample so playback never runs ahead
+    // of the data. Between samples it slowly moves back to track clock drift.
+    const int32_t offset = static_cast<int32_t>(stepsLocal - stepsMaster);
+    if (_numSamples == 0 || offset > _offset)
+        _offset = offset;
+    else if (offset < _offset)
+        --_offset;
+
+    if (_numSamples > 0) {
+        const Sample& last = _samples[_numSamples - 1];
+        const uint32_t gap = stepsMaster - last.steps;
+        const uint32_t rampSteps = _intervalSteps > 0 ? _intervalSteps : 1;
+        if (gap > rampSteps && (_intervalSteps == 0 || gap > 2 * _intervalSteps)) {
+            // a hold: the color only changed within the last interval
+            int held[5];
+            for(int i=0; i < 5; ++i)
+                held[i] = last.vals[i];
+            addSample(stepsMaster - rampSteps, held);
+        }
+        if (_intervalSteps == 0 || gap < _intervalSteps)
+            _intervalSteps = gap;
+    }
+
+    addSample(stepsMaster, vals);
+    _mode = mode;
+}
+
+void ColorSyncBuffer::addSample(uint32_t stepsMaster, const int vals[5]) {
+    if (_numSamples == _maxSamples) {
+        for(int i=1; i < _maxSamples; ++i)
+            _samples[i - 1] = _samples[i];
+        --_numSamples;
+    }
+
+    Sample& sample = _samples[_numSamples++];
+    sample.steps = stepsMaster;
+    for(int i=0; i < 5; ++i)
+        sample.vals[i] = vals[i];
+}
+
+bool ColorSyncBuffer::process(uint32_t stepsLocal, Mode& mode, int vals[5]) {
+    if (_numSamples == 0)
+        return false;
+
+    // playback position on the master timeline
+    const uint32_t pos = stepsLocal - _offset - _delaySteps;
+
+    const Sample* pFrom = &_samples[0];
+    const Sample* pTo = nullptr;
+    for(int i=1; i < _numSamples; ++i) {
+        if (static_cast<int32_t>(_samples[i].steps - pos) > 0) {
+            pTo = &_samples[i];
+            break;
+        }
+        pFrom = &_samples[i];
+    }
+
+    const int32_t elapsed = static_cast<int32_t>(pos - pFrom->steps);
+    if (!pTo || elapsed <= 0) {
+        // before the first or after the last sample: hold
+        for(int i=0; i < 5; ++i)
+            vals[i] = pFrom->vals[i];
+    }
+    else {
+        const int32_t span = static_cast<int32_t>(pTo->steps - pFrom->steps);
+        for(int i=0; i < 5; ++i) {
+            int diff = pTo->vals[i] - pFrom->vals[i];
+
+            // hue takes the shorter way around the wheel
+            if (_mode == Mode::Hsv && i == 0) {
+                if (diff > RGBWW_CALC_HUEWHEELMAX / 2)
+                    diff -= RGBWW_CALC_HUEWHEELMAX;
+                else if (diff < -RGBWW_CALC_HUEWHEELMAX / 2)
+                    diff += RGBWW_CALC_HUEWHEELMAX;
+            }
+
+            vals[i] = pFrom->vals[i] + diff * elapsed / span;
+
+            if (_mode == Mode::Hsv && i == 0) {
+                if (vals[i] < 0)
+                    vals[i] += RGBWW_CALC_HUEWHEELMAX;
+                else if (vals[i] >= RGBWW_CALC_HUEWHEELMAX)
+                    vals[i] -= RGBWW_CALC_HUEWHEELMAX;
+            }
+        }
+    }
+
+    mode = _mode;
+
+    bool changed = !_hasLast;
+    for(int i=0; i < 5; ++i) {
+        if (vals[i] != _lastVals[i])
+            changed = true;
+        _lastVals[i] = vals[i];
+    }
+    _hasLast = true;
+    return changed;
+}
@@ -0,0 +1,398 @@
+#include <RGBWWCtrl.h>
+
+
+/*
+ * Binary settings store
+ *
+ * Every section is a file APP_SETTINGS_SECTION_PREFIX<n>:
+ *   ['C']['F'][section:1][version:1][payload length:2][crc16:2][payload]
+ * The payload is a fixed sequence of little endian fields, strings are
+ * stored as [length:1][bytes]. A section with a bad crc or an unknown version
+ * keeps its defaults. Fields added later have to be appended and read only
+ * if the payload is long enough.
+ */
+
+static void putString(BinaryFrameWriter& frame, const String& str) {
+    const size_t len = str.length() < 255 ? str.length() : 255;
+    frame.put8(len);
+    frame.putBytes(str.c_str(), len);
+}
+
+static String getString(BinaryFrameReader& frame) {
+    const size_t len = frame.get8();
+    String str;
+    str.reserve(len);
+    for(size_t i=0; i < len && frame.isValid(); ++i)
+        str += static_cast<char>(frame.get8());
+    return str;
+}
+
+static void putFloat(BinaryFrameWriter& frame, float val) {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    frame.put32(bits);
+}
+
+static float getFloat(BinaryFrameReader& frame) {
+    const uint32_t bits = frame.get32();
+    float val;
+    memcpy(&val, &bits, sizeof(val));
+    return val;
+}
+
+String ApplicationSettings::getSectionFile(Section section) {
+    return String(APP_SETTINGS_SECTION_PREFIX) + String(static_cast<int>(section));
+}
+
+uint16_t ApplicationSettings::calcCrc(const uint8_t* pData, size_t len) {
+    // CRC-16/CCITT-FALSE
+    uint16_t crc = 0xffff;
+    for(size_t i=0; i < len; ++i) {
+        crc ^= static_cast<uint16_t>(pData[i]) << 8;
+        for(int bit=0; bit < 8; ++bit)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+void ApplicationSettings::writeSection(Section section, BinaryFrameWriter& frame) {
+    switch(section) {
+    case SectionNetwork:
+        frame.put8(network.connection.dhcp);
+        frame.put32(network.connection.ip);
+        frame.put32(network.connection.netmask);
+        frame.put32(network.connection.gateway);
+        putString(frame, network.connection.mdnshostname);
+        frame.put8(network.ap.secured);
+        putString(frame, network.ap.ssid);
+        putString(frame, network.ap.password);
+        break;
+
+    case SectionMqtt:
+        frame.put8(network.mqtt.enabled);
+        putString(frame, network.mqtt.server);
+        frame.put16(network.mqtt.port);
+        putString(frame, network.mqtt.username);
+        putString(frame, network.mqtt.password);
+        putString(frame, network.mqtt.topic_base);
+        frame.put32(network.mqtt.publish_interval_ms);
+        break;
+
+    case SectionSync:
+        frame.put8(sync.clock_master_enabled);
+        frame.put32(sync.clock_master_interval);
+        frame.put8(sync.clock_slave_enabled);
+        putString(frame, sync.clock_slave_topic);
+        frame.put8(sync.cmd_master_enabled);
+        frame.put8(sync.cmd_slave_enabled);
+        putString(frame, sync.cmd_slave_topic);
+        frame.put8(sync.color_master_enabled);
+        frame.put32(sync.color_master_interval_ms);
+        frame.put8(sync.color_master_binary);
+        frame.put8(sync.color_slave_enabled);
+        putString(frame, sync.color_slave_topic);
+        frame.put32(sync.color_slave_buffer_steps);
+        putString(frame, sync.clock_slave_controller);
+        frame.put8(sync.udp_enabled);
+        putString(frame, sync.udp_group);
+        frame.put16(sync.udp_port);
+        break;
+
+    case SectionColor:
+        frame.put8(color.outputmode);
+        putString(frame, color.startup_color);
+        frame.put8(color.hsv.model);
+        putFloat(frame, color.hsv.red);
+        putFloat(frame, color.hsv.yellow);
+        putFloat(frame, color.hsv.green);
+        putFloat(frame, color.hsv.cyan);
+        putFloat(frame, color.hsv.blue);
+        putFloat(frame, color.hsv.magenta);
+        frame.put16(color.brightness.red);
+        frame.put16(color.brightness.green);
+        frame.put16(color.brightness.blue);
+        frame.put16(color.brightness.ww);
+        frame.put16(color.brightness.cw);
+        frame.put16(color.colortemp.ww);
+        frame.put16(color.colortemp.cw);
+        break;
+
+    case SectionEvents:
+        frame.put8(events.server_enabled);
+        frame.put32(events.color_interval_ms);
+        frame.put32(events.color_mininterval_ms);
+        frame.put32(events.transfin_interval_ms);
+        break;
+
+    case SectionGeneral:
+        frame.put8(general.api_secured);
+        putString(frame, general.api_password);
+        putString(frame, general.otaurl);
+        putString(frame, general.device_name);
+        putString(frame, general.pin_config);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void ApplicationSettings::readSection(Section section, BinaryFrameReader& frame) {
+    switch(section) {
+    case SectionNetwork:
+        network.connection.dhcp = frame.get8();
+        network.connection.ip = IPAddress(frame.get32());
+        network.connection.netmask = IPAddress(frame.get32());
+        network.connection.gateway = IPAddress(frame.get32());
+        network.connection.mdnshostname = getString(frame);
+        network.ap.secured = frame.get8();
+        network.ap.ssid = getString(frame);
+        network.ap.password = getString(frame);
+        break;
+
+    case SectionMqtt:
+        network.mqtt.enabled = frame.get8();
+        network.mqtt.server = getString(frame);
+        network.mqtt.port = frame.get16();
+        network.mqtt.username = getString(frame);
+        network.mqtt.password = getString(frame);
+        network.mqtt.topic_base = getString(frame);
+        network.mqtt.publish_interval_ms = static_cast<int32_t>(frame.get32());
+        break;
+
+    case SectionSync:
+        sync.clock_master_enabled = frame.get8();
+        sync.clock_master_interval = static_cast<int32_t>(frame.get32());
+        sync.clock_slave_enabled = frame.get8();
+        sync.clock_slave_topic = getString(frame);
+        sync.cmd_master_enabled = frame.get8();
+        sync.cmd_slave_enabled = frame.get8();
+        sync.cmd_slave_topic = getString(frame);
+        sync.color_master_enabled = frame.get8();
+        sync.color_master_interval_ms = static_cast<int32_t>(frame.get32());
+        sync.color_master_binary = frame.get8();
+        sync.color_slave_enabled = frame.get8();
+        sync.color_slave_topic = getString(frame);
+        sync.color_slave_buffer_steps = static_cast<int32_t>(frame.get32());
+        if (frame.getRemaining() > 0)
+            sync.clock_slave_controller = getString(frame);
+        if (frame.getRemaining() > 0) {
+            sync.udp_enabled = frame.get8();
+            sync.udp_group = getString(frame);
+            sync.udp_port = frame.get16();
+        }
+        break;
+
+    case SectionColor:
+        color.outputmode = frame.get8();
+        color.startup_color = getString(frame);
+        color.hsv.model = frame.get8();
+        color.hsv.red = getFloat(frame);
+        color.hsv.yellow = getFloat(frame);
+        color.hsv.green = getFloat(frame);
+        color.hsv.cyan = getFloat(frame);
+        color.hsv.blue = getFloat(frame);
+        color.hsv.magenta = getFloat(frame);
+        color.brightness.red = frame.get16();
+        color.brightness.green = frame.get16();
+        color.brightness.blue = frame.get16();
+        color.brightness.ww = frame.get16();
+        color.brightness.cw = frame.get16();
+        color.colortemp.ww = frame.get16();
+        color.colortemp.cw = frame.get16();
+        break;
+
+    case SectionEvents:
+        events.server_enabled = frame.get8();
+        events.color_interval_ms = static_cast<int32_t>(frame.get32());
+        events.color_mininterval_ms = static_cast<int32_t>(frame.get32());
+        events.transfin_interval_ms = static_cast<int32_t>(frame.get32());
+        break;
+
+    case SectionGeneral:
+        general.api_secured = frame.get8();
+        general.api_password = getString(frame);
+        general.otaurl = getString(frame);
+        general.device_name = getString(frame);
+        general.pin_config = getString(frame);
+        break;
+
+    default:
+        break;
+    }
+}
+
+bool ApplicationSettings::loadSection(Section section) {
+    const String fileName = getSectionFile(section);
+    if (!fileExist(fileName))
+        return false;
+
+    // read binary, String copies would stop at the first 0 byte
+    file_t file = fileOpen(fileName, eFO_ReadOnly);
+    if (file < 0)
+        return false;
+
+    uint8_t* pData = new uint8_t[_sectionHeaderSize + _maxSectionSize];
+    const int read = fileRead(file, pData, _sectionHeaderSize + _maxSectionSize);
+    uint8_t extra;
+    const bool tooLarge = fileRead(file, &extra, 1) > 0;
+    fileClose(file);
+
+    if (read < static_cast<int>(_sectionHeaderSize) || pData[0] != 'C' || pData[1] != 'F' || pData[2] != section) {
+        debug_e("ApplicationSettings: %s is not a settings section\n", fileName.c_str());
+        delete[] pData;
+        return false;
+    }
+
+    BinaryFrameReader header(pData + 4, 4);
+    const size_t len = header.get16();
+    const uint16_t crc = header.get16();
+    if (tooLarge || static_cast<size_t>(read) != _sectionHeaderSize + len || calcCrc(pData + _sectionHeaderSize, len) != crc) {
+        debug_e("ApplicationSettings: %s is corrupt, using defaults\n", fileName.c_str());
+        delete[] pData;
+        return false;
+    }
+
+    if (pData[3] != _sectionVersion) {
+        debug_e("ApplicationSettings: %s has unknown version %d\n", fileName.c_str(), pData[3]);
+        delete[] pData;
+        return false;
+    }
+
+    BinaryFrameReader frame(pData + _sectionHeaderSize, len);
+    readSection(section, frame);
+    delete[] pData;
+
+    _sectionCrc[section] = crc;
+    _sectionStored[section] = true;
+    return true;
+}
+
+bool ApplicationSettings::serializeSection(Section section, BinaryFrameWriter& frame, uint16_t& crc) {
+    writeSection(section, frame);
+    if (!frame.isValid()) {
+        debug_e("ApplicationSettings: section %d is too large\n", section);
+        return false;
+    }
+
+    crc = calcCrc(frame.getData(), frame.getLength());
+    return !_sectionStored[section] || _sectionCrc[section] != crc;
+}
+
+uint32_t ApplicationSettings::getChangedSections() {
+    uint8_t* pBuf = new uint8_t[_maxSectionSize];
+    uint32_t changed = 0;
+    for(int i=0; i < SectionCount; ++i) {
+        BinaryFrameWriter frame(pBuf, _maxSectionSize);
+        uint16_t crc;
+        if (serializeSection(static_cast<Section>(i), frame, crc))
+            changed |= 1 << i;
+    }
+    delete[] pBuf;
+    return changed;
+}
+
+bool ApplicationSettings::saveSection(Section section, bool force) {
+    uint8_t* pBuf = new uint8_t[_sectionHeaderSize + _maxSectionSize];
+    BinaryFrameWriter frame(pBuf + _sectionHeaderSize, _maxSectionSize);
+    uint16_t crc;
+    const bool changed = serializeSection(section, frame, crc);
+    if (!frame.isValid() || (!changed && !force)) {
+        delete[] pBuf;
+        return frame.isValid();
+    }
+
+    BinaryFrameWriter header(pBuf, _sectionHeaderSize);
+    header.put8('C');
+    header.put8('F');
+    header.put8(section);
+    header.put8(_sectionVersion);
+    header.put16(frame.getLength());
+    header.put16(crc);
+
+    debug_d("ApplicationSettings: writing section %d\n", section);
+    const int len = _sectionHeaderSize + frame.getLength();
+    bool ok = false;
+    file_t file = fileOpen(getSectionFile(section), eFO_CreateNewAlways | eFO_WriteOnly);
+    if (file >= 0) {
+        ok = fileWrite(file, pBuf, len) == len;
+        fileClose(file);
+    }
+    delete[] pBuf;
+
+    if (!ok) {
+        debug_e("ApplicationSettings: writing section %d failed\n", section);
+        return false;
+    }
+
+    _sectionCrc[section] = crc;
+    _sectionStored[section] = true;
+    return true;
+}
+
+void ApplicationSettings::load(bool print) {
+    bool found = false;
+    for(int i=0; i < SectionCount; ++i) {
+        if (loadSection(static_cast<Section>(i)))
+            found = true;
+    }
+
+    if (!found && fileExist(APP_SETTINGS_FILE)) {
+        // first boot after an update: import the JSON settings once
+        debug_i("ApplicationSettings: importing %s\n", APP_SETTINGS_FILE);
+        DynamicJsonBuffer jsonBuffer;
+        String jsonString = fileGetContent(APP_SETTINGS_FILE);
+        JsonObject& root = jsonBuffer.parseObject(jsonString);
+        importJson(root);
+        sanitizeValues();
+        save();
+
+        // only drop the old file once all sections read back
+        bool imported = true;
+        for(int i=0; i < SectionCount; ++i) {
+            if (!loadSection(static_cast<Section>(i)))
+                imported = false;
+        }
+        if (imported)
+            fileDelete(APP_SETTINGS_FILE);
+        else
+            debug_e("ApplicationSettings: keeping %s, the imported settings do not read back\n", APP_SETTINGS_FILE);
+    }
+
+    sanitizeValues();
+
+    if (print) {
+        DynamicJsonBuffer jsonBuffer;
+        JsonObject& root = jsonBuffer.createObject();
+        exportJson(root);
+        root.prettyPrintTo(Serial);
+    }
+}
+
+void ApplicationSettings::save(bool print, bool force) {
+    for(int i=0; i < SectionCount; ++i)
+        saveSection(static_cast<Section>(i), force);
+
+    if (print) {
+        DynamicJsonBuffer jsonBuffer;
+        JsonObject& root = jsonBuffer.createObject();
+        exportJson(root);
+        root.prettyPrintTo(Serial);
+    }
+}
+
+bool ApplicationSettings::exist() {
+    return fileExist(getSectionFile(SectionGeneral)) || fileExist(APP_SETTINGS_FILE);
+}
+
+void ApplicationSettings::reset() {
+    for(int i=0; i < SectionCount; ++i) {
+        const String fileName = getSectionFile(static_cast<Section>(i));
+        if (fileExist(fileName))
+            fileDelete(fileName);
+        _sectionStored[i] = false;
+    }
+
+    if (fileExist(APP_SETTINGS_FILE))
+        fileDelete(APP_SETTINGS_FILE);
+}
@@ -0,0 +1,43 @@
+#include <RGBWWCtrl.h>
+
+
+EventPayload EventPayload::_pool[EventPayload::_poolSize];
+char EventPayload::_poolBuffers[EventPayload::_poolSize][EventPayload::_poolSlotSize];
+
+EventPayload* EventPayload::create(size_t capacity, bool droppable) {
+    EventPayload* pPayload = nullptr;
+
+    if (capacity <= _poolSlotSize) {
+        for(int i=0; i < _poolSize; ++i) {
+            if (_pool[i]._refCount == 0) {
+                pPayload = &_pool[i];
+                pPayload->_pData = _poolBuffers[i];
+                pPayload->_capacity = _poolSlotSize;
+                pPayload->_pooled = true;
+                break;
+            }
+        }
+    }
+
+    if (!pPayload) {
+        pPayload = new EventPayload();
+        pPayload->_pData = new char[capacity];
+        pPayload->_capacity = capacity;
+        pPayload->_pooled = false;
+    }
+
+    pPayload->_len = 0;
+    pPayload->_refCount = 1;
+    pPayload->_droppable = droppable;
+    return pPayload;
+}
+
+void EventPayload::release() {
+    if (_refCount == 0 || --_refCount > 0)
+        return;
+
+    if (!_pooled) {
+        delete[] _pData;
+        delete this;
+    }
+}
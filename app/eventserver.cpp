@@ -5,110 +5,592 @@
  *      Author: Robin
  */
 #include <RGBWWCtrl.h>
+#include <algorithm>
 
 
+EventServerClient::EventServerClient(tcp_pcb* clientTcp, TcpClientDataDelegate clientReceive, TcpClientCompleteDelegate onCompleted)
+    : TcpClient(clientTcp, clientReceive, onCompleted) {
+}
+
+EventServerClient::~EventServerClient() {
+    while (_numQueued > 0)
+        removeEntry(0);
+}
+
+void EventServerClient::removeEntry(int idx) {
+    if (_queue[idx].pPayload->isDroppable())
+        --_numDroppable;
+    _queue[idx].pPayload->release();
+
+    for(int i=idx + 1; i < _numQueued; ++i)
+        _queue[i - 1] = _queue[i];
+    --_numQueued;
+}
+
+bool EventServerClient::dropOldestUnsent() {
+    for(int i=0; i < _numQueued; ++i) {
+        if (_queue[i].pPayload->isDroppable() && _queue[i].written == 0) {
+            removeEntry(i);
+            ++_numDropped;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventServerClient::enqueue(EventPayload* pPayload) {
+    if (_closing)
+        return;
+
+    if (pPayload->isDroppable() && _numDroppable >= _maxDroppable && !dropOldestUnsent()) {
+        ++_numDropped;
+        return;
+    }
+
+    if (_numQueued >= _maxQueued && !dropOldestUnsent()) {
+        // only non droppable events left: the client does not read at all
+        // the server closes it after iterating its connections, see EventServer::closePendingClients()
+        debug_e("EventServerClient::enqueue: queue full - closing connection to %s\n", getRemoteIp().toString().c_str());
+        _closing = true;
+        while (_numQueued > 0)
+            removeEntry(0);
+        return;
+    }
+
+    pPayload->addRef();
+    _queue[_numQueued].pPayload = pPayload;
+    _queue[_numQueued].written = 0;
+    ++_numQueued;
+    if (pPayload->isDroppable())
+        ++_numDroppable;
+
+    pump();
+}
+
+void EventServerClient::pump() {
+    bool wrote = false;
+    while (_numQueued > 0) {
+        QueueEntry& entry = _queue[0];
+        const int remaining = entry.pPayload->getLength() - entry.written;
+
+        // only write what fits into the TCP send buffer, the rest follows in onSent()
+        const int available = getAvailableWriteSize();
+        if (available <= 0)
+            break;
+
+        const int len = write(entry.pPayload->getData() + entry.written, std::min(remaining, available));
+        if (len <= 0)
+            break;
+
+        wrote = true;
+        entry.written += len;
+        if (len < remaining)
+            break;
+
+        removeEntry(0);
+    }
+
+    if (wrote)
+        flush();
+}
+
+err_t EventServerClient::onSent(uint16_t len) {
+    const err_t res = TcpClient::onSent(len);
+    pump();
+    return res;
+}
+
+void EventServerClient::unsubscribeAll() {
+    for(int i=0; i < EventTypeCount; ++i)
+        _subscriptions[i].enabled = false;
+    _pendingTransitions.clear();
+}
+
+void EventServerClient::deferTransition(const String& name, bool requeued) {
+    if (!_subscriptions[EventTransitionFinished].enabled)
+        return;
+
+    // the same name again only updates the requeued state
+    if (!_pendingTransitions.contains(name) && _pendingTransitions.count() >= _maxPendingTransitions) {
+        debug_w("EventServerClient::deferTransition: too many pending - dropping %s\n", name.c_str());
+        ++_numDropped;
+        return;
+    }
+    _pendingTransitions[name] = requeued;
+}
+
+void EventServerClient::subscribe(EventType type, uint32_t minIntervalMs) {
+    Subscription& sub = _subscriptions[type];
+    sub.enabled = true;
+    sub.pending = false;
+    sub.minIntervalMs = minIntervalMs;
+    // allow the next event to be sent right away
+    sub.lastSentMs = millis() - minIntervalMs;
+}
+
+bool EventServerClient::select(EventType type, uint32_t now, bool changed) {
+    Subscription& sub = _subscriptions[type];
+    _selected = false;
+
+    if (!sub.enabled || !(changed || sub.pending))
+        return false;
+
+    if (sub.minIntervalMs > 0 && (now - sub.lastSentMs) < sub.minIntervalMs) {
+        sub.pending = true;
+        return false;
+    }
+
+    sub.pending = false;
+    sub.lastSentMs = now;
+    _selected = true;
+    return true;
+}
+
+bool EventServerClient::getEventType(const String& name, EventType& type) {
+    if (name == "color_event")
+        type = EventColor;
+    else if (name == "transition_finished")
+        type = EventTransitionFinished;
+    else if (name == "clock_slave_status")
+        type = EventClockSlaveStatus;
+    else if (name == "keep_alive")
+        type = EventKeepAlive;
+    else
+        return false;
+    return true;
+}
+
+bool EventServerClient::feed(char c) {
+    if (_rxDepth == 0) {
+        // skip anything between requests
+        if (c != '{')
+            return false;
+        _rxBuf = "";
+    }
+
+    if (_rxBuf.length() >= _maxRequestLen) {
+        debug_w("EventServerClient::feed: request too long - discarding\n");
+        _rxDepth = 0;
+        _rxInString = false;
+        _rxEscape = false;
+        return false;
+    }
+
+    _rxBuf += c;
+
+    if (_rxInString) {
+        if (_rxEscape)
+            _rxEscape = false;
+        else if (c == '\\')
+            _rxEscape = true;
+        else if (c == '"')
+            _rxInString = false;
+        return false;
+    }
+
+    if (c == '"') {
+        _rxInString = true;
+    }
+    else if (c == '{') {
+        ++_rxDepth;
+    }
+    else if (c == '}') {
+        --_rxDepth;
+        return _rxDepth == 0;
+    }
+    return false;
+}
+
+////////////////////////////////////////
+
 EventServer::~EventServer() {
-    stop();
+    if (active)
+        shutdown();
 }
 
 void EventServer::start() {
     debug_i("Starting event server\n");
-    setTimeOut(_connectionTimeout);
-    if (not listen(_tcpPort)) {
-        debug_e("EventServer failed to open listening port!");
+    _enabled = true;
+    if (!_listening) {
+        setTimeOut(_connectionTimeout);
+        if (not listen(_tcpPort)) {
+            debug_e("EventServer failed to open listening port!");
+        }
+        _listening = true;
     }
 
     _keepAliveTimer.initializeMs(_keepAliveInterval * 1000, TimerDelegate(&EventServer::publishKeepAlive, this)).start();
+    _pendingTimer.initializeMs(_pendingCheckMs, TimerDelegate(&EventServer::sendPendingTransitions, this));
 }
 
 void EventServer::stop() {
-    if (not active)
-        return;
+    // the port stays open, so the server can be enabled again without a reboot
+    debug_i("Stopping event server\n");
+    _enabled = false;
+    _keepAliveTimer.stop();
+    _pendingTimer.stop();
+    // backwards, closing may remove the client from connections
+    for(int i=connections.size() - 1; i >= 0; --i)
+        connections[i]->close();
+}
 
-    shutdown();
+TcpConnection* EventServer::createClient(tcp_pcb *clientTcp) {
+    return new EventServerClient(clientTcp,
+            TcpClientDataDelegate(&EventServer::onClientReceive, this),
+            TcpClientCompleteDelegate(&EventServer::onClientComplete, this));
 }
 
 void EventServer::onClient(TcpClient *client) {
     TcpServer::onClient(client);
+    if (!_enabled) {
+        client->close();
+        return;
+    }
     debug_d("Client connected from: %s\n", client->getRemoteIp().toString().c_str());
 }
 
+bool EventServer::onClientReceive(TcpClient& client, char *data, int size) {
+    EventServerClient& evClient = static_cast<EventServerClient&>(client);
+    for(int i=0; i < size; ++i) {
+        if (evClient.feed(data[i]))
+            processRequest(evClient, evClient.getRequest());
+    }
+    closePendingClients();
+    return true;
+}
+
 void EventServer::onClientComplete(TcpClient& client, bool succesfull) {
     TcpServer::onClientComplete(client, succesfull);
     debug_d("Client removed: %x\n", &client);
 }
 
-void EventServer::publishCurrentState(const ChannelOutput& raw, const HSVCT* pHsv) {
-    if (raw == _lastRaw)
-        return;
-    _lastRaw = raw;
+void EventServer::processRequest(EventServerClient& client, const String& request) {
+    debug_d("EventServer::processRequest: %s\n", request.c_str());
 
-    JsonRpcMessage msg("color_event");
-    JsonObject& root = msg.getParams();
+    JsonRpcMessageIn rpc(request);
+    const String method = rpc.getMethod();
+    if (method == "hello") {
+        JsonObject& params = rpc.getParams();
+        if (params["format"].success()) {
+            const String format = params["format"].asString();
+            if (format == "binary")
+                client.setFormat(EventServerClient::Format::Binary);
+            else if (format == "json")
+                client.setFormat(EventServerClient::Format::Json);
+        }
+    }
+    else if (method == "subscribe") {
+        JsonObject& params = rpc.getParams();
+        if (!params["events"].is<JsonObject&>()) {
+            debug_w("EventServer::processRequest: subscribe without events\n");
+            return;
+        }
 
-    root["mode"] = pHsv ? "hsv" : "raw";
+        client.unsubscribeAll();
+        JsonObject& events = params["events"].asObject();
+        for(auto kv : events) {
+            EventServerClient::EventType type;
+            if (!EventServerClient::getEventType(kv.key, type)) {
+                debug_w("EventServer::processRequest: unknown event: %s\n", kv.key);
+                continue;
+            }
+            const int interval = kv.value.as<int>();
+            client.subscribe(type, interval > 0 ? interval : 0);
+        }
+    }
+    else if (method == "sync") {
+        // sync telemetry of the slave as the result of the request, JSON
+        // clients only as it does not fit into a binary frame
+        JsonVariant id = rpc.getRoot()["id"];
+        if (client.getFormat() != EventServerClient::Format::Json || !id.success()) {
+            debug_w("EventServer::processRequest: sync needs the json format and an id\n");
+            return;
+        }
 
-    JsonObject& rawJson = root.createNestedObject("raw");
-    rawJson["r"] = raw.r;
-    rawJson["g"] = raw.g;
-    rawJson["b"] = raw.b;
-    rawJson["ww"] = raw.ww;
-    rawJson["cw"] = raw.cw;
+        JsonObject& params = rpc.getParams();
+        const int maxSamples = params["samples"].success() ? params["samples"].as<int>() : -1;
 
-    if (pHsv) {
-        float h, s, v;
-        int ct;
-        pHsv->asRadian(h, s, v, ct);
+        DynamicJsonBuffer jsonBuffer;
+        JsonObject& reply = jsonBuffer.createObject();
+        reply["jsonrpc"] = "2.0";
+        JsonObject& result = reply.createNestedObject("result");
+        SyncTelemetry& telemetry = app.rgbwwctrl.getSyncTelemetry();
+        if (maxSamples >= 0)
+            telemetry.toJson(result, maxSamples);
+        else
+            telemetry.toJson(result);
+        result["controller"] = app.cfg.sync.clock_slave_controller;
+        result["udp"] = app.syncudp.hasClock();
+        reply["id"] = id;
 
-        JsonObject& hsvJson = root.createNestedObject("hsv");
-        hsvJson["h"] = h;
-        hsvJson["s"] = s;
-        hsvJson["v"] = v;
-        hsvJson["ct"] = ct;
+        EventPayload* pPayload = createPayload(reply, false);
+        client.enqueue(pPayload);
+        pPayload->release();
+    }
+    else {
+        debug_w("EventServer::processRequest: unknown method: %s\n", method.c_str());
     }
+}
+
+void EventServer::publishCurrentState(const ChannelOutput& raw, const HSVCT* pHsv) {
+    // clients which skipped a color event due to their interval still get the latest one
+    const bool changed = !(raw == _lastRaw);
+    _lastRaw = raw;
+
+    if (!selectClients(EventServerClient::EventColor, changed))
+        return;
 
     debug_d("EventServer::publishCurrentHsv\n");
 
-    sendToClients(msg);
+    if (hasClients(EventServerClient::Format::Json)) {
+        // color events are sent on every step during fades, so they are serialized
+        // into a pooled payload instead of using a JsonRpcMessage
+        EventPayload* pPayload = EventPayload::create(EventPayload::_poolSlotSize, true);
+        JsonRpcStaticMessage msg(pPayload->getBuffer(), pPayload->getCapacity(), "color_event");
+        msg.beginObject("params");
+        msg.add("mode", pHsv ? "hsv" : "raw");
+
+        msg.beginObject("raw");
+        msg.add("r", raw.r);
+        msg.add("g", raw.g);
+        msg.add("b", raw.b);
+        msg.add("ww", raw.ww);
+        msg.add("cw", raw.cw);
+        msg.endObject();
+
+        if (pHsv) {
+            msg.beginObject("hsv");
+            msg.addFixed2("h", (pHsv->h * 36000 + RGBWW_CALC_HUEWHEELMAX / 2) / RGBWW_CALC_HUEWHEELMAX);
+            msg.addFixed2("s", (pHsv->s * 10000 + RGBWW_CALC_MAXVAL / 2) / RGBWW_CALC_MAXVAL);
+            msg.addFixed2("v", (pHsv->v * 10000 + RGBWW_CALC_MAXVAL / 2) / RGBWW_CALC_MAXVAL);
+            msg.add("ct", pHsv->ct);
+            msg.endObject();
+        }
+
+        msg.setId(_nextId++);
+
+        if (msg.isValid()) {
+            pPayload->setLength(msg.getLength());
+            sendToClients(pPayload, EventServerClient::Format::Json);
+        }
+        else {
+            debug_e("EventServer::publishCurrentState: color event buffer too small\n");
+        }
+        pPayload->release();
+    }
+
+    if (hasClients(EventServerClient::Format::Binary)) {
+        EventPayload* pPayload = EventPayload::create(2 + 7 + 8, true);
+        BinaryFrameWriter frame(reinterpret_cast<uint8_t*>(pPayload->getBuffer()), pPayload->getCapacity());
+        frame.put8(pHsv ? FrameColorHsv : FrameColorRaw);
+        frame.put8(0);
+        frame.putPacked10(raw.r, raw.g, raw.b, raw.ww, raw.cw);
+        if (pHsv) {
+            frame.put16(pHsv->h);
+            frame.put16(pHsv->s);
+            frame.put16(pHsv->v);
+            frame.put16(pHsv->ct);
+        }
+        sendFrame(pPayload, frame);
+    }
 }
 
 void EventServer::publishClockSlaveStatus(uint32_t offset, uint32_t interval) {
     debug_d("EventServer::publishClockSlaveStatus: offset: %d | interval :%d\n", offset, interval);
 
-    JsonRpcMessage msg("clock_slave_status");
-    JsonObject& root = msg.getParams();
-    root["offset"] = offset;
-    root["current_interval"] = interval;
-    sendToClients(msg);
+    if (!selectClients(EventServerClient::EventClockSlaveStatus))
+        return;
+
+    if (hasClients(EventServerClient::Format::Json)) {
+        JsonRpcMessage msg("clock_slave_status");
+        JsonObject& root = msg.getParams();
+        root["offset"] = offset;
+        root["current_interval"] = interval;
+        sendToClients(msg, true);
+    }
+
+    if (hasClients(EventServerClient::Format::Binary)) {
+        EventPayload* pPayload = EventPayload::create(2 + 8, true);
+        BinaryFrameWriter frame(reinterpret_cast<uint8_t*>(pPayload->getBuffer()), pPayload->getCapacity());
+        frame.put8(FrameClockSlaveStatus);
+        frame.put8(0);
+        frame.put32(offset);
+        frame.put32(interval);
+        sendFrame(pPayload, frame);
+    }
 }
 
 void EventServer::publishKeepAlive() {
     debug_d("EventServer::publishKeepAlive\n");
 
-    JsonRpcMessage msg("keep_alive");
-    sendToClients(msg);
+    if (!selectClients(EventServerClient::EventKeepAlive))
+        return;
+
+    if (hasClients(EventServerClient::Format::Json)) {
+        JsonRpcMessage msg("keep_alive");
+        sendToClients(msg, true);
+    }
+
+    if (hasClients(EventServerClient::Format::Binary)) {
+        EventPayload* pPayload = EventPayload::create(2, true);
+        BinaryFrameWriter frame(reinterpret_cast<uint8_t*>(pPayload->getBuffer()), pPayload->getCapacity());
+        frame.put8(FrameKeepAlive);
+        frame.put8(0);
+        sendFrame(pPayload, frame);
+    }
 }
 
 void EventServer::publishTransitionFinished(const String& name, bool requeued) {
     debug_d("EventServer::publishTransitionComplete: %s\n", name.c_str());
 
-    JsonRpcMessage msg("transition_finished");
-    JsonObject& root = msg.getParams();
-    root["name"] = name;
-    root["requeued"] = requeued;
+    // serialized once per format for the clients without an interval, the
+    // others collect the names until their interval has passed
+    const uint32_t now = millis();
+    EventPayload* pPayloads[2] = { nullptr, nullptr };
+    bool deferred = false;
+    for(int i=0; i < connections.size(); ++i) {
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (!pClient->isSubscribed(EventServerClient::EventTransitionFinished))
+            continue;
+
+        if (pClient->getMinInterval(EventServerClient::EventTransitionFinished) > 0) {
+            pClient->deferTransition(name, requeued);
+            if (pClient->select(EventServerClient::EventTransitionFinished, now, true))
+                sendPendingTransitionsTo(*pClient);
+            else
+                deferred = true;
+            continue;
+        }
+
+        EventPayload*& pPayload = pPayloads[static_cast<int>(pClient->getFormat())];
+        if (!pPayload)
+            pPayload = createTransitionFinished(pClient->getFormat(), name, requeued);
+        pClient->enqueue(pPayload);
+    }
 
-    sendToClients(msg);
+    for(EventPayload* pPayload : pPayloads) {
+        if (pPayload)
+            pPayload->release();
+    }
+    closePendingClients();
+
+    if (deferred && !_pendingTimer.isStarted())
+        _pendingTimer.start();
 }
 
-void EventServer::sendToClients(JsonRpcMessage& rpcMsg) {
-    //Serial.printf("EventServer: sendToClient: %x, Vector: %x Tests: %d\n", _client, _clients.elementAt(0), _tests[0]);
+void EventServer::sendPendingTransitions() {
+    const uint32_t now = millis();
+    bool deferred = false;
+    for(int i=0; i < connections.size(); ++i) {
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (pClient->getPendingTransitions().count() == 0)
+            continue;
+
+        if (pClient->select(EventServerClient::EventTransitionFinished, now, false))
+            sendPendingTransitionsTo(*pClient);
+        else
+            deferred = true;
+    }
+    closePendingClients();
+
+    if (!deferred)
+        _pendingTimer.stop();
+}
+
+void EventServer::sendPendingTransitionsTo(EventServerClient& client) {
+    HashMap<String, bool>& pending = client.getPendingTransitions();
+    for(unsigned int i=0; i < pending.count(); ++i) {
+        EventPayload* pPayload = createTransitionFinished(client.getFormat(), pending.keyAt(i), pending.valueAt(i));
+        client.enqueue(pPayload);
+        pPayload->release();
+    }
+    pending.clear();
+}
+
+EventPayload* EventServer::createTransitionFinished(EventServerClient::Format format, const String& name, bool requeued) {
+    if (format == EventServerClient::Format::Json) {
+        JsonRpcMessage msg("transition_finished");
+        JsonObject& root = msg.getParams();
+        root["name"] = name;
+        root["requeued"] = requeued;
+        msg.setId(_nextId++);
+        return createPayload(msg.getRoot(), false);
+    }
+
+    const size_t nameLen = std::min(name.length(), UINT8_MAX - 1u);
+    EventPayload* pPayload = EventPayload::create(2 + 1 + nameLen, false);
+    BinaryFrameWriter frame(reinterpret_cast<uint8_t*>(pPayload->getBuffer()), pPayload->getCapacity());
+    frame.put8(FrameTransitionFinished);
+    frame.put8(1 + nameLen);
+    frame.put8(requeued ? 1 : 0);
+    frame.putBytes(name.c_str(), nameLen);
+    pPayload->setLength(frame.getLength());
+    return pPayload;
+}
+
+bool EventServer::selectClients(EventServerClient::EventType type, bool changed) {
+    const uint32_t now = millis();
+    bool selected = false;
+    for(int i=0; i < connections.size(); ++i) {
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (pClient->select(type, now, changed))
+            selected = true;
+    }
+    return selected;
+}
+
+bool EventServer::hasClients(EventServerClient::Format format) {
+    for(int i=0; i < connections.size(); ++i) {
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (pClient->isSelected() && pClient->getFormat() == format)
+            return true;
+    }
+    return false;
+}
+
+void EventServer::sendToClients(JsonRpcMessage& rpcMsg, bool droppable) {
     rpcMsg.setId(_nextId++);
 
-    String jsonStr;
-    rpcMsg.getRoot().printTo(jsonStr);
+    EventPayload* pPayload = createPayload(rpcMsg.getRoot(), droppable);
+    sendToClients(pPayload, EventServerClient::Format::Json);
+    pPayload->release();
+}
+
+EventPayload* EventServer::createPayload(JsonObject& root, bool droppable) {
+    const size_t len = root.measureLength();
+    EventPayload* pPayload = EventPayload::create(len + 1, droppable);
+    root.printTo(pPayload->getBuffer(), len + 1);
+    pPayload->setLength(len);
+    return pPayload;
+}
+
+void EventServer::sendFrame(EventPayload* pPayload, BinaryFrameWriter& frame) {
+    if (frame.isValid()) {
+        // fill in the payload length
+        frame.set8(1, frame.getLength() - 2);
+        pPayload->setLength(frame.getLength());
+        sendToClients(pPayload, EventServerClient::Format::Binary);
+    }
+    else {
+        debug_e("EventServer::sendFrame: frame buffer too small\n");
+    }
+    pPayload->release();
+}
 
+void EventServer::sendToClients(EventPayload* pPayload, EventServerClient::Format format) {
     for(int i=0; i < connections.size(); ++i) {
-        TcpClient* pClient = (TcpClient*)connections[i];
-        pClient->sendString(jsonStr);
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (pClient->isSelected() && pClient->getFormat() == format)
+            pClient->enqueue(pPayload);
+    }
+    closePendingClients();
+}
+
+void EventServer::closePendingClients() {
+    // backwards, closing may remove the client from connections
+    for(int i=connections.size() - 1; i >= 0; --i) {
+        EventServerClient* pClient = static_cast<EventServerClient*>(connections[i]);
+        if (pClient->isClosing())
+            pClient->close();
     }
 }
@@ -0,0 +1,232 @@
+#include <RGBWWCtrl.h>
+
+
+// generated from p^2, 1-(1-p)^2, quadratic in-out and cubic in-out
+const uint16_t FadeEngine::_tableIn[FadeEngine::_tableSize] = {
+        0,    64,   256,   576,  1024,  1600,  2304,  3136,  4096,  5184,  6400,
+     7744,  9216, 10816, 12544, 14400, 16384, 18496, 20736, 23104, 25600, 28224,
+    30976, 33855, 36863, 39999, 43263, 46655, 50175, 53823, 57599, 61503, 65535,
+};
+
+const uint16_t FadeEngine::_tableOut[FadeEngine::_tableSize] = {
+        0,  4032,  7936, 11712, 15360, 18880, 22272, 25536, 28672, 31680, 34559,
+    37311, 39935, 42431, 44799, 47039, 49151, 51135, 52991, 54719, 56319, 57791,
+    59135, 60351, 61439, 62399, 63231, 63935, 64511, 64959, 65279, 65471, 65535,
+};
+
+const uint16_t FadeEngine::_tableInOut[FadeEngine::_tableSize] = {
+        0,   128,   512,  1152,  2048,  3200,  4608,  6272,  8192, 10368, 12800,
+    15488, 18432, 21632, 25088, 28800, 32768, 36735, 40447, 43903, 47103, 50047,
+    52735, 55167, 57343, 59263, 60927, 62335, 63487, 64383, 65023, 65407, 65535,
+};
+
+const uint16_t FadeEngine::_tableCubic[FadeEngine::_tableSize] = {
+        0,     8,    64,   216,   512,  1000,  1728,  2744,  4096,  5832,  8000,
+    10648, 13824, 17576, 21952, 27000, 32768, 38535, 43583, 47959, 51711, 54887,
+    57535, 59703, 61439, 62791, 63807, 64535, 65023, 65319, 65471, 65527, 65535,
+};
+
+// CIE 1976: Y = ((L + 16) / 116)^3, linear below L = 8
+const uint16_t FadeEngine::_tableLightness[FadeEngine::_tableSize] = {
+        0,   227,   453,   686,   972,  1328,  1762,  2281,  2894,  3607,  4429,
+     5367,  6429,  7623,  8956, 10436, 12071, 13868, 15835, 17980, 20310, 22833,
+    25558, 28490, 31639, 35012, 38616, 42460, 46550, 50895, 55503, 60380, 65535,
+};
+
+
+bool FadeEngine::parseEase(const char* name, Ease& ease) {
+    if (strcmp(name, "linear") == 0)
+        ease = Ease::Linear;
+    else if (strcmp(name, "smooth") == 0)
+        ease = Ease::Smooth;
+    else if (strcmp(name, "in") == 0)
+        ease = Ease::In;
+    else if (strcmp(name, "out") == 0)
+        ease = Ease::Out;
+    else if (strcmp(name, "inout") == 0)
+        ease = Ease::InOut;
+    else if (strcmp(name, "cubic") == 0)
+        ease = Ease::Cubic;
+    else if (strcmp(name, "log") == 0)
+        ease = Ease::Log;
+    else
+        return false;
+    return true;
+}
+
+uint32_t FadeEngine::applyEase(Ease ease, uint32_t pos) {
+    if (pos >= _one)
+        return _one;
+
+    switch(ease) {
+    case Ease::Smooth:
+    {
+        // smoothstep 3p^2 - 2p^3, all products stay below 2^32
+        const uint32_t p2 = (pos * pos) >> 16;
+        return 3 * p2 - ((p2 * pos) >> 15);
+    }
+    case Ease::In:
+        return interpolate(_tableIn, pos, 11);
+    case Ease::Out:
+        return interpolate(_tableOut, pos, 11);
+    case Ease::InOut:
+        return interpolate(_tableInOut, pos, 11);
+    case Ease::Cubic:
+        return interpolate(_tableCubic, pos, 11);
+    case Ease::Log:
+    case Ease::Linear:
+    default:
+        return pos;
+    }
+}
+
+uint32_t FadeEngine::interpolate(const uint16_t* pTable, uint32_t x, int segmentBits) {
+    const uint32_t idx = x >> segmentBits;
+    if (idx >= _tableSize - 1)
+        return pTable[_tableSize - 1];
+
+    const uint32_t frac = x & ((1 << segmentBits) - 1);
+    const uint32_t a = pTable[idx];
+    const uint32_t b = pTable[idx + 1];
+    return a + (((b - a) * frac + (1 << (segmentBits - 1))) >> segmentBits);
+}
+
+uint32_t FadeEngine::toLightness(int val, int maxVal) {
+    // only at the start of a fade: binary search in the lightness table
+    const uint32_t lum = static_cast<uint32_t>(val) * 65535 / maxVal;
+    uint32_t lo = 0;
+    uint32_t hi = _lightnessOne;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi + 1) / 2;
+        if (interpolate(_tableLightness, mid, 10) <= lum)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+int FadeEngine::fromLightness(uint32_t lightness, int maxVal) {
+    return (interpolate(_tableLightness, lightness, 10) * maxVal + 32767) / 65535;
+}
+
+void FadeEngine::start(bool raw, const int from[5], const int to[5], uint32_t steps, Ease ease, int direction, const String& name) {
+    int delta[5];
+    for(int i=0; i < 5; ++i)
+        delta[i] = to[i] - from[i];
+
+    if (!raw) {
+        // same rule as the hue transitions of the controller: 1 = shorter way
+        const int period = RGBWW_CALC_HUEWHEELMAX;
+        int& d = delta[0];
+        if (d > period / 2)
+            d -= period;
+        else if (d < -period / 2)
+            d += period;
+        if (direction != 1 && d != 0)
+            d += (d > 0) ? -period : period;
+    }
+
+    resume(raw, from, delta, steps, 0, ease, direction, name);
+}
+
+void FadeEngine::resume(bool raw, const int from[5], const int delta[5], uint32_t steps, uint32_t step, Ease ease, int direction, const String& name) {
+    _raw = raw;
+    _ease = ease;
+    _direction = direction;
+    _name = name;
+    _steps = steps > 0 ? steps : 1;
+    _step = step < _steps ? step : _steps;
+
+    for(int i=0; i < 5; ++i) {
+        _from[i] = from[i];
+        _delta[i] = delta[i];
+    }
+
+    // brightness channels of log fades
+    _lightnessMask = 0;
+    if (ease == Ease::Log)
+        _lightnessMask = raw ? 0x1f : 0x04;
+
+    for(int i=0; i < 5; ++i) {
+        if (!(_lightnessMask & (1 << i)))
+            continue;
+        _fromLightness[i] = toLightness(from[i], RGBWW_CALC_MAXVAL);
+        _deltaLightness[i] = static_cast<int32_t>(toLightness(from[i] + delta[i], RGBWW_CALC_MAXVAL)) - _fromLightness[i];
+    }
+
+    // the position the increments below accumulate to after _step steps
+    const uint64_t done = static_cast<uint64_t>(_step) * _one;
+    _pos = done / _steps;
+    _rem = done % _steps;
+    _posInc = _one / _steps;
+    _remInc = _one % _steps;
+    _active = _step < _steps;
+}
+
+void FadeEngine::getFrom(int from[5]) const {
+    for(int i=0; i < 5; ++i)
+        from[i] = _from[i];
+}
+
+void FadeEngine::getDelta(int delta[5]) const {
+    for(int i=0; i < 5; ++i)
+        delta[i] = _delta[i];
+}
+
+void FadeEngine::getTarget(int to[5]) const {
+    for(int i=0; i < 5; ++i)
+        to[i] = _from[i] + _delta[i];
+
+    if (!_raw) {
+        if (to[0] < 0)
+            to[0] += RGBWW_CALC_HUEWHEELMAX;
+        else if (to[0] >= RGBWW_CALC_HUEWHEELMAX)
+            to[0] -= RGBWW_CALC_HUEWHEELMAX;
+    }
+}
+
+bool FadeEngine::process(int vals[5]) {
+    if (++_step >= _steps) {
+        _pos = _one;
+    }
+    else {
+        _pos += _posInc;
+        _rem += _remInc;
+        if (_rem >= _steps) {
+            _rem -= _steps;
+            ++_pos;
+        }
+    }
+
+    const int32_t eased = static_cast<int32_t>(applyEase(_ease, _pos));
+    for(int i=0; i < 5; ++i) {
+        if (_pos >= _one) {
+            // the tables are not exact at the end
+            vals[i] = _from[i] + _delta[i];
+            continue;
+        }
+
+        // round half away from zero, identical for both fade directions
+        const int32_t delta = (_lightnessMask & (1 << i)) ? _deltaLightness[i] : _delta[i];
+        const int32_t scaled = delta * eased;
+        const int32_t offset = scaled >= 0 ? (scaled + 0x8000) >> 16 : -((-scaled + 0x8000) >> 16);
+
+        if (_lightnessMask & (1 << i))
+            vals[i] = fromLightness(_fromLightness[i] + offset, RGBWW_CALC_MAXVAL);
+        else
+            vals[i] = _from[i] + offset;
+    }
+
+    if (!_raw) {
+        const int period = RGBWW_CALC_HUEWHEELMAX;
+        if (vals[0] < 0)
+            vals[0] += period;
+        else if (vals[0] >= period)
+            vals[0] -= period;
+    }
+
+    if (_pos >= _one)
+        _active = false;
+    return !_active;
+}
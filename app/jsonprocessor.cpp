@@ -1,45 +1,122 @@
 #include <RGBWWCtrl.h>
+#include <algorithm>
 
 
-bool JsonProcessor::onColor(const String& json, String& msg, bool relay) {
-    debug_e("JsonProcessor::onColor: %s", json.c_str());
-    DynamicJsonBuffer jsonBuffer;
-    JsonObject& root = jsonBuffer.parseObject(json);
-    return onColor(root, msg, relay);
+bool JsonProcessor::onColor(const String& json, String& msg, bool relay, JsonArray* pResults) {
+    debug_d("JsonProcessor::onColor: %s\n", json.c_str());
+    const bool result = onColor(json.c_str(), json.length(), msg, pResults);
+
+    // a batch is relayed as one message
+    if (relay && result)
+        app.onCommandRelay("color", json);
+
+    return result;
 }
 
-bool JsonProcessor::onColor(JsonObject& root, String& msg, bool relay) {
-    bool result = false;
-    if (root["cmds"].success()) {
-        Vector<String> errors;
-        // multi command post (needs testing)
-        const JsonArray& cmds = root["cmds"].asArray();
-        for(int i=0; i < cmds.size(); ++i) {
-            String msg;
-            if (!onSingleColorCommand(cmds[i], msg))
-                errors.add(msg);
+bool JsonProcessor::onColor(const char* pJson, size_t len, String& msg, JsonArray* pResults) {
+    // color commands are parsed in a single pass without building a DOM
+    JsonTokenizer tok(pJson, len);
+    if (tok.next() != JsonTokenizer::Token::BeginObject) {
+        msg = getParseError(tok);
+        return false;
+    }
+
+    RequestParameters params;
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        if (token == JsonTokenizer::Token::EndObject)
+            break;
+
+        if (token == JsonTokenizer::Token::BeginArray && tok.isKey("cmds")) {
+            const size_t start = tok.getTokenStart();
+            if (!tok.skip()) {
+                msg = getParseError(tok);
+                return false;
+            }
+            return onColorBatch(pJson + start, tok.getPos() - start, msg, pResults);
         }
 
-        if (errors.size() == 0)
-            result = true;
-        else {
-            String msg;
-            for (int i=0; i < errors.size(); ++i)
-                msg += errors[i] + "|";
-            result = false;
+        if (!parseRequestParam(tok, token, params)) {
+            msg = getParseError(tok);
+            return false;
         }
     }
-    else {
-        if (onSingleColorCommand(root, msg))
-            result = true;
-        else
-            result = false;
+
+    return executeColorCommand(params, msg);
+}
+
+bool JsonProcessor::onColorBatch(const char* pCmds, size_t len, String& msg, JsonArray* pResults) {
+    // validate all commands first, nothing is queued if one of them is invalid
+    int numCmds = 0;
+    const int numInvalid = processBatch(pCmds, len, false, numCmds, msg, nullptr);
+    if (numInvalid < 0)
+        return false;
+
+    if (numCmds > RGBWW_ANIMATIONQSIZE) {
+        msg = "Too many commands (max ";
+        msg += RGBWW_ANIMATIONQSIZE;
+        msg += ")";
+        return false;
     }
 
-    if (relay)
-        app.onCommandRelay("color", root);
+    if (numInvalid > 0) {
+        // run again to report the result of each command
+        msg = "";
+        processBatch(pCmds, len, false, numCmds, msg, pResults);
+        return false;
+    }
 
-    return result;
+    return processBatch(pCmds, len, true, numCmds, msg, pResults) == 0;
+}
+
+int JsonProcessor::processBatch(const char* pCmds, size_t len, bool execute, int& numCmds, String& msg, JsonArray* pResults) {
+    JsonTokenizer tok(pCmds, len);
+    tok.next();
+
+    numCmds = 0;
+    int numFailed = 0;
+    JsonTokenizer::Token token;
+    while ((token = tok.next()) == JsonTokenizer::Token::BeginObject) {
+        RequestParameters params;
+        if (!parseRequestParams(tok, params)) {
+            msg = getParseError(tok);
+            return -1;
+        }
+
+        String error;
+        bool ok;
+        if (execute) {
+            ok = executeColorCommand(params, error);
+        }
+        else {
+            ok = params.checkParams(error) == 0;
+            if (ok && params.mode == RequestParameters::Mode::Undefined) {
+                error = "No color object!";
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            ++numFailed;
+            msg += String(numCmds) + ": " + error + "|";
+        }
+
+        if (pResults) {
+            JsonObject& result = pResults->createNestedObject();
+            if (ok)
+                result["success"] = true;
+            else
+                result["error"] = error;
+        }
+        ++numCmds;
+    }
+
+    if (token != JsonTokenizer::Token::EndArray) {
+        msg = getParseError(tok);
+        return -1;
+    }
+
+    return numFailed;
 }
 
 bool JsonProcessor::onStop(const String& json, String& msg, bool relay) {
@@ -53,6 +130,7 @@ bool JsonProcessor::onStop(JsonObject& root, String& msg, bool relay) {
     JsonProcessor::parseRequestParams(root, params);
     app.rgbwwctrl.clearAnimationQueue(params.channels);
     app.rgbwwctrl.skipAnimation(params.channels);
+    app.rgbwwctrl.wake();
 
     onDirect(root, msg, false);
 
@@ -74,6 +152,7 @@ bool JsonProcessor::onSkip(JsonObject& root, String& msg, bool relay) {
     RequestParameters params;
     JsonProcessor::parseRequestParams(root, params);
     app.rgbwwctrl.skipAnimation(params.channels);
+    app.rgbwwctrl.wake();
 
     onDirect(root, msg, false);
 
@@ -117,6 +196,7 @@ bool JsonProcessor::onContinue(JsonObject& root, String& msg, bool relay) {
     RequestParameters params;
     JsonProcessor::parseRequestParams(root, params);
     app.rgbwwctrl.continueAnimation(params.channels);
+    app.rgbwwctrl.wake();
 
     if (relay)
         app.onCommandRelay("continue", root);
@@ -131,6 +211,9 @@ bool JsonProcessor::onBlink(const String& json, String& msg, bool relay) {
 }
 
 bool JsonProcessor::onBlink(JsonObject& root, String& msg, bool relay) {
+    app.rgbwwctrl.stopAppAnimations();
+    app.rgbwwctrl.wake();
+
     RequestParameters params;
     params.ramp.value = 500; //default
 
@@ -144,13 +227,23 @@ bool JsonProcessor::onBlink(JsonObject& root, String& msg, bool relay) {
     return true;
 }
 
-bool JsonProcessor::onSingleColorCommand(JsonObject& root, String& errorMsg) {
-    RequestParameters params;
-    parseRequestParams(root, params);
+bool JsonProcessor::executeColorCommand(const RequestParameters& params, String& errorMsg) {
+    // a rejected command leaves a running animation program alone
     if (params.checkParams(errorMsg) != 0) {
         return false;
     }
 
+    if (params.mode == RequestParameters::Mode::Undefined) {
+        errorMsg = "No color object!";
+        return false;
+    }
+
+    app.rgbwwctrl.stopAppAnimations();
+    app.rgbwwctrl.wake();
+
+    if (params.ease.length() > 0)
+        return startEasedFade(params, errorMsg);
+
     bool queueOk = false;
     if (params.mode == RequestParameters::Mode::Kelvin) {
         //TODO: hand to rgbctrl
@@ -174,9 +267,6 @@ bool JsonProcessor::onSingleColorCommand(JsonObject& root, String& errorMsg) {
         } else {
             app.rgbwwctrl.fadeRAW(params.rawFrom, params.raw, params.ramp, params.queue);
         }
-    } else {
-        errorMsg = "No color object!";
-        return false;
     }
 
     if (!queueOk)
@@ -184,6 +274,73 @@ bool JsonProcessor::onSingleColorCommand(JsonObject& root, String& errorMsg) {
     return queueOk;
 }
 
+static int resolveValue(const AbsOrRelValue& value, int current, int maxVal, bool isHue) {
+    if (!value.hasValue())
+        return current;
+
+    int result = value.getValue();
+    if (value.getMode() == AbsOrRelValue::Mode::Relative)
+        result += current;
+
+    if (isHue) {
+        result %= RGBWW_CALC_HUEWHEELMAX;
+        if (result < 0)
+            result += RGBWW_CALC_HUEWHEELMAX;
+        return result;
+    }
+    return std::min(std::max(result, 0), maxVal);
+}
+
+bool JsonProcessor::startEasedFade(const RequestParameters& params, String& errorMsg) {
+    FadeEngine::Ease ease;
+    FadeEngine::parseEase(params.ease.c_str(), ease);
+
+    int from[5] = { 0 };
+    int to[5] = { 0 };
+    const AbsOrRelValue* pTo[5] = { nullptr };
+    const AbsOrRelValue* pFrom[5] = { nullptr };
+    int maxVals[5] = { RGBWW_CALC_MAXVAL, RGBWW_CALC_MAXVAL, RGBWW_CALC_MAXVAL, RGBWW_CALC_MAXVAL, RGBWW_CALC_MAXVAL };
+
+    const bool raw = params.mode == RequestParameters::Mode::Raw;
+    if (params.mode == RequestParameters::Mode::Hsv) {
+        const HSVCT& c = app.rgbwwctrl.getCurrentColor();
+        const int cur[5] = { c.h, c.s, c.v, c.ct, 0 };
+        memcpy(from, cur, sizeof(from));
+        pTo[0] = &params.hsv.h; pTo[1] = &params.hsv.s; pTo[2] = &params.hsv.v; pTo[3] = &params.hsv.ct;
+        if (params.hasHsvFrom) {
+            pFrom[0] = &params.hsvFrom.h; pFrom[1] = &params.hsvFrom.s; pFrom[2] = &params.hsvFrom.v; pFrom[3] = &params.hsvFrom.ct;
+        }
+        maxVals[3] = 10000;
+    }
+    else if (raw) {
+        const ChannelOutput& c = app.rgbwwctrl.getCurrentOutput();
+        const int cur[5] = { c.r, c.g, c.b, c.ww, c.cw };
+        memcpy(from, cur, sizeof(from));
+        pTo[0] = &params.raw.r; pTo[1] = &params.raw.g; pTo[2] = &params.raw.b; pTo[3] = &params.raw.ww; pTo[4] = &params.raw.cw;
+        if (params.hasRawFrom) {
+            pFrom[0] = &params.rawFrom.r; pFrom[1] = &params.rawFrom.g; pFrom[2] = &params.rawFrom.b; pFrom[3] = &params.rawFrom.ww; pFrom[4] = &params.rawFrom.cw;
+        }
+    }
+    else {
+        errorMsg = "No color object!";
+        return false;
+    }
+
+    for(int i=0; i < 5; ++i) {
+        const bool isHue = !raw && i == 0;
+        if (pFrom[i])
+            from[i] = resolveValue(*pFrom[i], from[i], maxVals[i], isHue);
+        to[i] = pTo[i] ? resolveValue(*pTo[i], from[i], maxVals[i], isHue) : from[i];
+    }
+
+    const int timeMs = static_cast<int>(params.ramp.value);
+    const uint32_t steps = (std::max(timeMs, 0) + RGBWW_MINTIMEDIFF / 2) / RGBWW_MINTIMEDIFF;
+
+    app.rgbwwctrl.clearAnimationQueue();
+    app.rgbwwctrl.getFadeEngine().start(raw, from, to, steps, ease, params.direction, params.name);
+    return true;
+}
+
 bool JsonProcessor::onDirect(const String& json, String& msg, bool relay) {
     DynamicJsonBuffer jsonBuffer;
     JsonObject& root = jsonBuffer.parseObject(json);
@@ -191,6 +348,9 @@ bool JsonProcessor::onDirect(const String& json, String& msg, bool relay) {
 }
 
 bool JsonProcessor::onDirect(JsonObject& root, String& msg, bool relay) {
+    app.rgbwwctrl.stopAppAnimations();
+    app.rgbwwctrl.wake();
+
     RequestParameters params;
     JsonProcessor::parseRequestParams(root, params);
 
@@ -225,13 +385,13 @@ void JsonProcessor::parseRequestParams(JsonObject& root, RequestParameters& para
         if (root["hsv"]["from"].success()) {
             params.hasHsvFrom = true;
             if (root["hsv"]["from"]["h"].success())
-                params.hsv.h = AbsOrRelValue(root["hsv"]["from"]["h"].asString(), AbsOrRelValue::Type::Hue);
+                params.hsvFrom.h = AbsOrRelValue(root["hsv"]["from"]["h"].asString(), AbsOrRelValue::Type::Hue);
             if (root["hsv"]["from"]["s"].success())
-                params.hsv.s = AbsOrRelValue(root["hsv"]["from"]["s"].asString());
+                params.hsvFrom.s = AbsOrRelValue(root["hsv"]["from"]["s"].asString());
             if (root["hsv"]["from"]["v"].success())
-                params.hsv.v = AbsOrRelValue(root["hsv"]["from"]["v"].asString());
+                params.hsvFrom.v = AbsOrRelValue(root["hsv"]["from"]["v"].asString());
             if (root["hsv"]["from"]["ct"].success())
-                params.hsv.ct = AbsOrRelValue(root["hsv"]["from"]["ct"].asString(), AbsOrRelValue::Type::Ct);
+                params.hsvFrom.ct = AbsOrRelValue(root["hsv"]["from"]["ct"].asString(), AbsOrRelValue::Type::Ct);
         }
     }
     else if (root["raw"].success()) {
@@ -267,7 +427,7 @@ void JsonProcessor::parseRequestParams(JsonObject& root, RequestParameters& para
     }
 
     if (root["t"].success()) {
-        params.ramp.value = root["t"].as<double>();
+        params.ramp.value = root["t"].as<int>();
         params.ramp.type = RampTimeOrSpeed::Type::Time;
     }
 
@@ -292,6 +452,10 @@ void JsonProcessor::parseRequestParams(JsonObject& root, RequestParameters& para
         params.name = root["name"].asString();
     }
 
+    if (root["ease"].success()) {
+        params.ease = root["ease"].asString();
+    }
+
     if (root["cmd"].success()) {
         params.cmd = root["cmd"].asString();
     }
@@ -331,6 +495,222 @@ void JsonProcessor::parseRequestParams(JsonObject& root, RequestParameters& para
     }
 }
 
+const char* JsonProcessor::getParseError(const JsonTokenizer& tok) {
+    return tok.isTruncated() ? "Value too long" : "Invalid JSON";
+}
+
+bool JsonProcessor::parseRequestParams(JsonTokenizer& tok, RequestParameters& params) {
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        if (token == JsonTokenizer::Token::EndObject)
+            return true;
+        if (!parseRequestParam(tok, token, params))
+            return false;
+    }
+}
+
+bool JsonProcessor::parseRequestParam(JsonTokenizer& tok, JsonTokenizer::Token token, RequestParameters& params) {
+    switch(token) {
+    case JsonTokenizer::Token::BeginObject:
+        if (tok.isKey("hsv")) {
+            if (params.mode != RequestParameters::Mode::Kelvin)
+                params.mode = RequestParameters::Mode::Hsv;
+            return parseHsv(tok, params.hsv, params, false);
+        }
+        if (tok.isKey("raw")) {
+            if (params.mode == RequestParameters::Mode::Undefined)
+                params.mode = RequestParameters::Mode::Raw;
+            return parseRaw(tok, params.raw, params, false);
+        }
+        return tok.skip();
+
+    case JsonTokenizer::Token::BeginArray:
+        if (tok.isKey("channels"))
+            return parseChannels(tok, params);
+        return tok.skip();
+
+    case JsonTokenizer::Token::String:
+    case JsonTokenizer::Token::Number:
+    case JsonTokenizer::Token::Literal:
+        break;
+
+    default:
+        return false;
+    }
+
+    const char* value = tok.getValue();
+    if (tok.isKey("t")) {
+        params.ramp.value = atoi(value);
+        params.ramp.type = RampTimeOrSpeed::Type::Time;
+    }
+    else if (tok.isKey("s")) {
+        params.ramp.value = atof(value);
+        params.ramp.type = RampTimeOrSpeed::Type::Speed;
+    }
+    else if (tok.isKey("r")) {
+        params.requeue = tok.isValue("true") || atoi(value) == 1;
+    }
+    else if (tok.isKey("kelvin")) {
+        params.mode = RequestParameters::Mode::Kelvin;
+        params.kelvin = atoi(value);
+    }
+    else if (tok.isKey("d")) {
+        params.direction = atoi(value);
+    }
+    else if (tok.isKey("to")) {
+        params.loopTo = atoi(value);
+    }
+    else if (tok.isKey("count")) {
+        params.loopCount = atoi(value);
+    }
+    else if (tok.isKey("name")) {
+        params.name = value;
+    }
+    else if (tok.isKey("ease")) {
+        params.ease = value;
+    }
+    else if (tok.isKey("cmd")) {
+        params.cmd = value;
+    }
+    else if (tok.isKey("q")) {
+        if (tok.isValue("back"))
+            params.queue = QueuePolicy::Back;
+        else if (tok.isValue("front"))
+            params.queue = QueuePolicy::Front;
+        else if (tok.isValue("front_reset"))
+            params.queue = QueuePolicy::FrontReset;
+        else if (tok.isValue("single"))
+            params.queue = QueuePolicy::Single;
+        else
+            params.queue = QueuePolicy::Invalid;
+    }
+    return true;
+}
+
+bool JsonProcessor::parseHsv(JsonTokenizer& tok, RequestHSVCT& hsv, RequestParameters& params, bool isFrom) {
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        switch(token) {
+        case JsonTokenizer::Token::EndObject:
+            return true;
+
+        case JsonTokenizer::Token::BeginObject:
+            if (!isFrom && tok.isKey("from")) {
+                params.hasHsvFrom = true;
+                if (!parseHsv(tok, params.hsvFrom, params, true))
+                    return false;
+            }
+            else if (!tok.skip()) {
+                return false;
+            }
+            break;
+
+        case JsonTokenizer::Token::BeginArray:
+            if (!tok.skip())
+                return false;
+            break;
+
+        case JsonTokenizer::Token::String:
+        case JsonTokenizer::Token::Number:
+            if (tok.isKey("h"))
+                hsv.h = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Hue);
+            else if (tok.isKey("s"))
+                hsv.s = AbsOrRelValue(tok.getValue());
+            else if (tok.isKey("v"))
+                hsv.v = AbsOrRelValue(tok.getValue());
+            else if (tok.isKey("ct"))
+                hsv.ct = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Ct);
+            break;
+
+        case JsonTokenizer::Token::Literal:
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
+
+bool JsonProcessor::parseRaw(JsonTokenizer& tok, RequestChannelOutput& raw, RequestParameters& params, bool isFrom) {
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        switch(token) {
+        case JsonTokenizer::Token::EndObject:
+            return true;
+
+        case JsonTokenizer::Token::BeginObject:
+            if (!isFrom && tok.isKey("from")) {
+                params.hasRawFrom = true;
+                if (!parseRaw(tok, params.rawFrom, params, true))
+                    return false;
+            }
+            else if (!tok.skip()) {
+                return false;
+            }
+            break;
+
+        case JsonTokenizer::Token::BeginArray:
+            if (!tok.skip())
+                return false;
+            break;
+
+        case JsonTokenizer::Token::String:
+        case JsonTokenizer::Token::Number:
+            if (tok.isKey("r"))
+                raw.r = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Raw);
+            else if (tok.isKey("g"))
+                raw.g = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Raw);
+            else if (tok.isKey("b"))
+                raw.b = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Raw);
+            else if (tok.isKey("ww"))
+                raw.ww = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Raw);
+            else if (tok.isKey("cw"))
+                raw.cw = AbsOrRelValue(tok.getValue(), AbsOrRelValue::Type::Raw);
+            break;
+
+        case JsonTokenizer::Token::Literal:
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
+
+bool JsonProcessor::parseChannels(JsonTokenizer& tok, RequestParameters& params) {
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        switch(token) {
+        case JsonTokenizer::Token::EndArray:
+            return true;
+
+        case JsonTokenizer::Token::String:
+            if (tok.isValue("h"))
+                params.channels.add(CtrlChannel::Hue);
+            else if (tok.isValue("s"))
+                params.channels.add(CtrlChannel::Sat);
+            else if (tok.isValue("v"))
+                params.channels.add(CtrlChannel::Val);
+            else if (tok.isValue("ct"))
+                params.channels.add(CtrlChannel::ColorTemp);
+            break;
+
+        case JsonTokenizer::Token::BeginObject:
+        case JsonTokenizer::Token::BeginArray:
+            if (!tok.skip())
+                return false;
+            break;
+
+        case JsonTokenizer::Token::Number:
+        case JsonTokenizer::Token::Literal:
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
+
 int JsonProcessor::RequestParameters::checkParams(String& errorMsg) const {
     if (mode == Mode::Hsv) {
         if (hsv.ct.hasValue()) {
@@ -372,35 +752,255 @@ int JsonProcessor::RequestParameters::checkParams(String& errorMsg) const {
         return 1;
     }
 
+    if (ease.length() > 0) {
+        FadeEngine::Ease e;
+        if (!FadeEngine::parseEase(ease.c_str(), e)) {
+            errorMsg = "Invalid ease";
+            return 1;
+        }
+
+        if (cmd != "fade" || ramp.type != RampTimeOrSpeed::Type::Time || queue != QueuePolicy::Single) {
+            errorMsg = "ease needs a timed fade with queue policy single";
+            return 1;
+        }
+    }
+
     return 0;
 }
 
+bool JsonProcessor::onAnimation(const String& json, String& msg, bool relay) {
+    JsonTokenizer tok(json.c_str(), json.length());
+    if (tok.next() != JsonTokenizer::Token::BeginObject) {
+        msg = getParseError(tok);
+        return false;
+    }
+
+    // static, the step buffer is too large for the stack
+    static AnimationProgram program;
+    program.clear();
+    String name;
+    String play;
+    String remove;
+    bool hasSteps = false;
+    bool stop = false;
+    for(;;) {
+        JsonTokenizer::Token token = tok.next();
+        if (token == JsonTokenizer::Token::EndObject)
+            break;
+
+        if (token == JsonTokenizer::Token::BeginArray && tok.isKey("steps")) {
+            hasSteps = true;
+            while ((token = tok.next()) == JsonTokenizer::Token::BeginObject) {
+                RequestParameters params;
+                AnimationProgram::Step step;
+                if (!parseRequestParams(tok, params)) {
+                    msg = getParseError(tok);
+                    return false;
+                }
+                if (!compileAnimationStep(params, program.getNumSteps(), step, msg)) {
+                    msg = String(program.getNumSteps()) + ": " + msg;
+                    return false;
+                }
+                if (!program.addStep(step)) {
+                    msg = "Too many steps (max " + String(AnimationProgram::_maxSteps) + ")";
+                    return false;
+                }
+            }
+            if (token != JsonTokenizer::Token::EndArray) {
+                msg = getParseError(tok);
+                return false;
+            }
+        }
+        else if (token == JsonTokenizer::Token::BeginObject || token == JsonTokenizer::Token::BeginArray) {
+            tok.skip();
+        }
+        else if (token == JsonTokenizer::Token::Error || token == JsonTokenizer::Token::End) {
+            msg = getParseError(tok);
+            return false;
+        }
+        else if (tok.isKey("name")) {
+            name = tok.getValue();
+        }
+        else if (tok.isKey("play")) {
+            play = tok.getValue();
+        }
+        else if (tok.isKey("stop")) {
+            stop = tok.isValue("true");
+        }
+        else if (tok.isKey("delete")) {
+            // deleted once the whole request is valid
+            remove = tok.getValue();
+            if (!AnimationProgram::isValidName(remove)) {
+                msg = "Invalid name";
+                return false;
+            }
+        }
+    }
+
+    if (hasSteps && !AnimationProgram::isValidName(name)) {
+        msg = "Invalid name";
+        return false;
+    }
+
+    bool result = true;
+    if (remove.length() > 0)
+        AnimationProgram::remove(remove);
+
+    if (hasSteps) {
+        if (!program.save(name)) {
+            msg = "Could not save animation";
+            return false;
+        }
+    }
+
+    if (stop || play.length() > 0) {
+        app.rgbwwctrl.stopAppAnimations();
+        app.rgbwwctrl.wake();
+    }
+    if (play.length() > 0)
+        result = app.rgbwwctrl.getAnimationPlayer().play(play, msg);
+
+    // slaves store and play the same programs
+    if (relay && result)
+        app.onCommandRelay("animation", json);
+
+    return result;
+}
+
+bool JsonProcessor::compileAnimationStep(const RequestParameters& params, int idx, AnimationProgram::Step& step, String& errorMsg) {
+    if (params.cmd == "loop") {
+        if (params.loopTo < 0 || params.loopTo >= idx) {
+            errorMsg = "Invalid loop target";
+            return false;
+        }
+        step.op = AnimationProgram::OpLoop;
+        step.vals[0] = params.loopTo;
+        step.vals[1] = params.loopCount > 0 ? params.loopCount : 0;
+        return true;
+    }
+
+    if (params.ramp.type == RampTimeOrSpeed::Type::Speed || params.ease.length() > 0) {
+        errorMsg = "Speed and ease are not supported in animations";
+        return false;
+    }
+    step.time = params.ramp.value > 0 ? static_cast<uint32_t>(params.ramp.value) : 0;
+
+    if (params.cmd == "blink") {
+        step.op = AnimationProgram::OpBlink;
+        if (step.time == 0)
+            step.time = 500;
+        return true;
+    }
+
+    if (params.checkParams(errorMsg) != 0)
+        return false;
+
+    if (params.hasHsvFrom || params.hasRawFrom) {
+        errorMsg = "from is not supported in animations";
+        return false;
+    }
+
+    step.op = (params.cmd == "fade") ? AnimationProgram::OpFade : AnimationProgram::OpSolid;
+
+    const AbsOrRelValue* pVals[5];
+    if (params.mode == RequestParameters::Mode::Hsv) {
+        pVals[0] = &params.hsv.h;
+        pVals[1] = &params.hsv.s;
+        pVals[2] = &params.hsv.v;
+        pVals[3] = &params.hsv.ct;
+        pVals[4] = nullptr;
+        if (params.direction == 0)
+            step.flags |= AnimationProgram::FlagReverse;
+    }
+    else if (params.mode == RequestParameters::Mode::Raw) {
+        pVals[0] = &params.raw.r;
+        pVals[1] = &params.raw.g;
+        pVals[2] = &params.raw.b;
+        pVals[3] = &params.raw.ww;
+        pVals[4] = &params.raw.cw;
+        step.flags |= AnimationProgram::FlagRaw;
+    }
+    else {
+        errorMsg = "No color object!";
+        return false;
+    }
+
+    for(int i=0; i < 5; ++i) {
+        if (!pVals[i] || !pVals[i]->hasValue())
+            continue;
+
+        if (pVals[i]->getMode() != AbsOrRelValue::Mode::Absolute) {
+            errorMsg = "Relative values are not supported in animations";
+            return false;
+        }
+        step.mask |= (1 << i);
+        step.vals[i] = pVals[i]->getValue();
+    }
+    return true;
+}
+
 bool JsonProcessor::onJsonRpc(const String& json) {
     debug_d("JsonProcessor::onJsonRpc: %s\n", json.c_str());
-    JsonRpcMessageIn rpc(json);
+
+    // find method and params in a single pass so color commands can be parsed
+    // from the params directly
+    JsonTokenizer tok(json.c_str(), json.length());
+    if (tok.next() != JsonTokenizer::Token::BeginObject)
+        return false;
+
+    String method;
+    size_t paramsStart = 0;
+    size_t paramsEnd = 0;
+    for(;;) {
+        const JsonTokenizer::Token token = tok.next();
+        if (token == JsonTokenizer::Token::EndObject)
+            break;
+        if (token == JsonTokenizer::Token::Error || token == JsonTokenizer::Token::End)
+            return false;
+
+        if (token == JsonTokenizer::Token::BeginObject || token == JsonTokenizer::Token::BeginArray) {
+            const bool isParams = tok.isKey("params");
+            const size_t start = tok.getTokenStart();
+            if (!tok.skip())
+                return false;
+            if (isParams) {
+                paramsStart = start;
+                paramsEnd = tok.getPos();
+            }
+        }
+        else if (tok.isKey("method")) {
+            method = tok.getValue();
+        }
+    }
 
     String msg;
-    if (rpc.getMethod() == "color") {
-        return onColor(rpc.getParams(), msg, false);
+    if (method == "color") {
+        return onColor(json.c_str() + paramsStart, paramsEnd - paramsStart, msg);
     }
-    else if (rpc.getMethod() == "stop") {
+    else if (method == "animation") {
+        return onAnimation(String(json.c_str() + paramsStart, paramsEnd - paramsStart), msg, false);
+    }
+
+    JsonRpcMessageIn rpc(json);
+    if (method == "stop") {
         return onStop(rpc.getParams(), msg, false);
     }
-    else if (rpc.getMethod() == "blink") {
+    else if (method == "blink") {
         return onBlink(rpc.getParams(), msg, false);
     }
-    else if (rpc.getMethod() == "skip") {
+    else if (method == "skip") {
         return onSkip(rpc.getParams(), msg, false);
     }
-    else if (rpc.getMethod() == "pause") {
+    else if (method == "pause") {
         return onPause(rpc.getParams(), msg, false);
     }
-    else if (rpc.getMethod() == "continue") {
+    else if (method == "continue") {
         return onContinue(rpc.getParams(), msg, false);
     }
-    else if (rpc.getMethod() == "direct") {
+    else if (method == "direct") {
         return onDirect(rpc.getParams(), msg, false);
     }
+    return false;
 }
 
 void JsonProcessor::addChannelStatesToCmd(JsonObject& root, const RGBWWLed::ChannelList& channels) {
@@ -44,3 +44,101 @@ JsonObject& JsonRpcMessageIn::getRoot() {
 String JsonRpcMessageIn::getMethod() {
     return getRoot()["method"];
 }
+
+////////////////////////////////////////
+
+JsonRpcStaticMessage::JsonRpcStaticMessage(char* pBuf, size_t size, const char* method) : _pBuf(pBuf), _size(size) {
+    addRaw("{\"jsonrpc\":\"2.0\",\"method\":\"");
+    addRaw(method);
+    addRaw("\"");
+    _needComma[0] = true;
+}
+
+void JsonRpcStaticMessage::addChar(char c) {
+    // keep one byte for the terminating zero
+    if (_pos + 1 >= _size) {
+        _overflow = true;
+        return;
+    }
+    _pBuf[_pos++] = c;
+    _pBuf[_pos] = '\0';
+}
+
+void JsonRpcStaticMessage::addRaw(const char* str) {
+    while (*str)
+        addChar(*str++);
+}
+
+void JsonRpcStaticMessage::addNumber(int32_t value) {
+    char digits[11];
+    int num = 0;
+
+    uint32_t absVal = value < 0 ? -static_cast<uint32_t>(value) : value;
+    do {
+        digits[num++] = '0' + (absVal % 10);
+        absVal /= 10;
+    } while (absVal > 0);
+
+    if (value < 0)
+        addChar('-');
+    while (num > 0)
+        addChar(digits[--num]);
+}
+
+void JsonRpcStaticMessage::addKey(const char* key) {
+    if (_needComma[_depth])
+        addChar(',');
+    _needComma[_depth] = true;
+
+    addChar('"');
+    addRaw(key);
+    addRaw("\":");
+}
+
+void JsonRpcStaticMessage::beginObject(const char* key) {
+    if (_depth >= _maxDepth) {
+        _overflow = true;
+        return;
+    }
+    addKey(key);
+    addChar('{');
+    _needComma[++_depth] = false;
+}
+
+void JsonRpcStaticMessage::endObject() {
+    if (_depth == 0)
+        return;
+    addChar('}');
+    --_depth;
+}
+
+void JsonRpcStaticMessage::add(const char* key, int32_t value) {
+    addKey(key);
+    addNumber(value);
+}
+
+void JsonRpcStaticMessage::add(const char* key, const char* value) {
+    addKey(key);
+    addChar('"');
+    addRaw(value);
+    addChar('"');
+}
+
+void JsonRpcStaticMessage::addFixed2(const char* key, int32_t hundredths) {
+    addKey(key);
+    if (hundredths < 0) {
+        addChar('-');
+        hundredths = -hundredths;
+    }
+    addNumber(hundredths / 100);
+    addChar('.');
+    addChar('0' + (hundredths / 10) % 10);
+    addChar('0' + hundredths % 10);
+}
+
+void JsonRpcStaticMessage::setId(int id) {
+    while (_depth > 0)
+        endObject();
+    add("id", id);
+    addChar('}');
+}
@@ -0,0 +1,186 @@
+#include "jsontokenizer.h"
+
+#include <string.h>
+
+
+bool JsonTokenizer::isKey(const char* key) const {
+    return strcmp(_key, key) == 0;
+}
+
+bool JsonTokenizer::isValue(const char* value) const {
+    return strcmp(_value, value) == 0;
+}
+
+void JsonTokenizer::skipWhitespace() {
+    while (_pos < _len) {
+        const char c = _pData[_pos];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+            break;
+        ++_pos;
+    }
+}
+
+JsonTokenizer::Token JsonTokenizer::error() {
+    // stay in the error state
+    _pos = _len;
+    _depth = -1;
+    return Token::Error;
+}
+
+bool JsonTokenizer::readString(char* pBuf, size_t size) {
+    size_t len = 0;
+    ++_pos;
+    while (_pos < _len) {
+        char c = _pData[_pos++];
+        if (c == '"') {
+            pBuf[len] = '\0';
+            return true;
+        }
+
+        if (c == '\\') {
+            if (_pos >= _len)
+                break;
+            c = _pData[_pos++];
+            switch(c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u':
+                // non ASCII characters are not needed for any value we parse
+                _pos += 4;
+                c = '?';
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (len + 1 < size)
+            pBuf[len++] = c;
+        else
+            _truncated = true;
+    }
+    return false;
+}
+
+bool JsonTokenizer::readScalar() {
+    size_t len = 0;
+    while (_pos < _len) {
+        const char c = _pData[_pos];
+        const bool valid = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+        if (!valid)
+            break;
+
+        if (len + 1 < _maxValueLen)
+            _value[len++] = c;
+        else
+            _truncated = true;
+        ++_pos;
+    }
+    _value[len] = '\0';
+    return len > 0;
+}
+
+JsonTokenizer::Token JsonTokenizer::next() {
+    if (_depth < 0)
+        return Token::Error;
+
+    _key[0] = '\0';
+    _value[0] = '\0';
+    _truncated = false;
+
+    skipWhitespace();
+    if (_depth > 0 && _pos < _len) {
+        const char c = _pData[_pos];
+        const bool closing = c == '}' || c == ']';
+        if (_afterValue && !closing) {
+            // exactly one separator between values, none before the closing bracket
+            if (c != ',')
+                return error();
+            ++_pos;
+            skipWhitespace();
+            if (_pos < _len && (_pData[_pos] == '}' || _pData[_pos] == ']'))
+                return error();
+        }
+        else if (!_afterValue && c == ',') {
+            return error();
+        }
+    }
+
+    if (_pos >= _len)
+        return _depth == 0 ? Token::End : error();
+
+    _tokenStart = _pos;
+    char c = _pData[_pos];
+
+    const bool inObject = _depth > 0 && !(_arrayBits & (1 << (_depth - 1)));
+    if (inObject && c != '}') {
+        if (c != '"' || !readString(_key, sizeof(_key)))
+            return error();
+        _truncated = false;
+
+        skipWhitespace();
+        if (_pos >= _len || _pData[_pos] != ':')
+            return error();
+        ++_pos;
+
+        skipWhitespace();
+        if (_pos >= _len)
+            return error();
+        _tokenStart = _pos;
+        c = _pData[_pos];
+        if (c == '}' || c == ']')
+            return error();
+    }
+
+    switch(c) {
+    case '{':
+    case '[':
+        if (_depth >= _maxDepth)
+            return error();
+        if (c == '[')
+            _arrayBits |= (1 << _depth);
+        else
+            _arrayBits &= ~(1 << _depth);
+        ++_depth;
+        ++_pos;
+        _afterValue = false;
+        return c == '{' ? Token::BeginObject : Token::BeginArray;
+
+    case '}':
+    case ']':
+    {
+        const bool isArray = _depth > 0 && (_arrayBits & (1 << (_depth - 1)));
+        if (_depth == 0 || isArray != (c == ']'))
+            return error();
+        --_depth;
+        ++_pos;
+        _afterValue = true;
+        return c == '}' ? Token::EndObject : Token::EndArray;
+    }
+
+    case '"':
+        if (!readString(_value, sizeof(_value)) || _truncated)
+            return error();
+        _afterValue = true;
+        return Token::String;
+
+    default:
+        if (!readScalar() || _truncated)
+            return error();
+        _afterValue = true;
+        return (c == 't' || c == 'f' || c == 'n') ? Token::Literal : Token::Number;
+    }
+}
+
+bool JsonTokenizer::skip() {
+    const int depth = _depth - 1;
+    while (_depth > depth) {
+        const Token token = next();
+        if (token == Token::Error || token == Token::End)
+            return false;
+    }
+    return true;
+}
@@ -64,13 +64,18 @@ PinConfig APPLedCtrl::parsePinConfigString(String& pinStr) {
 void APPLedCtrl::init() {
     debug_i("APPLedCtrl::init");
 
-    _stepSync = new ClockCatchUp();
+    setupStepSync();
 
     const PinConfig pins = APPLedCtrl::parsePinConfigString(app.cfg.general.pin_config);
 
     RGBWWLed::init(pins.red, pins.green, pins.blue, pins.warmwhite, pins.coldwhite, PWM_FREQUENCY);
 
     setup();
+    setupSchedule();
+
+    // after a soft reset continue with the output from before
+    if (app.cfg.color.startup_color == "last" && resumeState())
+        return;
 
     HSVCT startupColor;
     if (app.cfg.color.startup_color == "last") {
@@ -89,19 +94,40 @@ void APPLedCtrl::init() {
     fadeHSV(startupColorDark, startupColor, 700); //fade to color in 700ms
 }
 
-void APPLedCtrl::setup() {
+bool APPLedCtrl::setup() {
     debug_i("APPLedCtrl::setup");
 
-    colorutils.setBrightnessCorrection(app.cfg.color.brightness.red,
-            app.cfg.color.brightness.green, app.cfg.color.brightness.blue,
-            app.cfg.color.brightness.ww, app.cfg.color.brightness.cw);
-    colorutils.setHSVcorrection(app.cfg.color.hsv.red, app.cfg.color.hsv.yellow,
-            app.cfg.color.hsv.green, app.cfg.color.hsv.cyan,
-            app.cfg.color.hsv.blue, app.cfg.color.hsv.magenta);
+    const struct ApplicationSettings::color& c = app.cfg.color;
+    const struct ApplicationSettings::color& a = _appliedColor;
+
+    // every setter rebuilds the correction state of colorutils, so only push what changed
+    bool changed = false;
+    if (!_colorApplied || c.brightness.red != a.brightness.red || c.brightness.green != a.brightness.green ||
+            c.brightness.blue != a.brightness.blue || c.brightness.ww != a.brightness.ww || c.brightness.cw != a.brightness.cw) {
+        colorutils.setBrightnessCorrection(c.brightness.red, c.brightness.green, c.brightness.blue,
+                c.brightness.ww, c.brightness.cw);
+        changed = true;
+    }
+
+    if (!_colorApplied || c.hsv.red != a.hsv.red || c.hsv.yellow != a.hsv.yellow || c.hsv.green != a.hsv.green ||
+            c.hsv.cyan != a.hsv.cyan || c.hsv.blue != a.hsv.blue || c.hsv.magenta != a.hsv.magenta) {
+        colorutils.setHSVcorrection(c.hsv.red, c.hsv.yellow, c.hsv.green, c.hsv.cyan, c.hsv.blue, c.hsv.magenta);
+        changed = true;
+    }
+
+    if (!_colorApplied || c.outputmode != a.outputmode) {
+        colorutils.setColorMode((RGBWW_COLORMODE) c.outputmode);
+        changed = true;
+    }
 
-    colorutils.setColorMode((RGBWW_COLORMODE) app.cfg.color.outputmode);
-    colorutils.setHSVmodel((RGBWW_HSVMODEL) app.cfg.color.hsv.model);
+    if (!_colorApplied || c.hsv.model != a.hsv.model) {
+        colorutils.setHSVmodel((RGBWW_HSVMODEL) c.hsv.model);
+        changed = true;
+    }
 
+    _appliedColor = c;
+    _colorApplied = true;
+    return changed;
 }
 
 void APPLedCtrl::publishToEventServer() {
@@ -122,9 +148,11 @@ void APPLedCtrl::publishToMqtt() {
     switch(_mode) {
     case ColorMode::Hsv:
         app.mqttclient.publishCurrentHsv(getCurrentColor());
+        app.syncudp.publishColor(_stepCounter, &getCurrentColor(), getCurrentOutput());
         break;
     case ColorMode::Raw:
         app.mqttclient.publishCurrentRaw(getCurrentOutput());
+        app.syncudp.publishColor(_stepCounter, NULL, getCurrentOutput());
         break;
     }
 }
@@ -134,25 +162,96 @@ void APPLedCtrl::updateLedCb(void* pTimerArg) {
     pThis->updateLed();
 }
 
+void APPLedCtrl::setupStepSync() {
+    const String& controller = app.cfg.sync.clock_slave_controller;
+    if (_stepSync && controller == _stepSyncController)
+        return;
+
+    debug_i("APPLedCtrl::setupStepSync %s\n", controller.c_str());
+    delete _stepSync;
+    if (controller == "pi")
+        _stepSync = new ClockPI();
+    else
+        _stepSync = new ClockCatchUp();
+    _stepSyncController = controller;
+    _timerInterval = _stepSync->reset();
+    _syncTelemetry.reset();
+}
+
+void APPLedCtrl::setupSchedule() {
+    const int clockMasterMs = app.cfg.sync.clock_master_enabled ? app.cfg.sync.clock_master_interval * 1000 : -1;
+    _scheduler.setInterval(TickScheduler::TaskClockMaster, clockMasterMs);
+    _scheduler.setInterval(TickScheduler::TaskColorEvent, app.cfg.events.color_interval_ms);
+    _scheduler.setInterval(TickScheduler::TaskColorMqtt, app.cfg.sync.color_master_interval_ms);
+    _scheduler.setInterval(TickScheduler::TaskTransitionFinished, app.cfg.events.transfin_interval_ms);
+}
+
 void APPLedCtrl::updateLed() {
+    // in idle mode one tick covers several steps
+    const uint32_t steps = _tickSteps;
+    _tickStats.beginTick(_armedIntervalUs);
+    _lastTickUs = micros();
+
     // arm next timer
-    ets_timer_arm_new(&_ledTimer, _timerInterval, 0, 0);
+    _tickSteps = _idle ? _idleTickSteps : 1;
+    _armedIntervalUs = _timerInterval * _tickSteps + _phaseCorrectionUs;
+    _phaseCorrectionUs = 0;
+    ets_timer_arm_new(&_ledTimer, _armedIntervalUs, 0, 0);
 
-    const bool animFinished = show();
+    bool animFinished = false;
+    for(uint32_t i=0; i < steps; ++i) {
+        if (app.cfg.sync.color_slave_enabled)
+            processColorSync();
 
-    ++_stepCounter;
+        if (_fadeEngine.isActive())
+            processFade();
 
-    if (app.cfg.sync.clock_master_enabled) {
-        if ((_stepCounter % (app.cfg.sync.clock_master_interval * RGBWW_UPDATEFREQUENCY)) == 0) {
-            app.mqttclient.publishClock(_stepCounter);
-        }
+        animFinished |= show();
+        _animationPlayer.process();
+
+        ++_stepCounter;
     }
+    checkIdle(steps);
+    _tickStats.stageDone(TickStats::StageRender);
+    _tickStats.endTick();
 
     const static uint32_t stepLenMs = 1000 / RGBWW_UPDATEFREQUENCY;
+    _deferredDue |= _scheduler.advance(stepLenMs * steps);
+    _deferredSteps += steps;
+    _deferredAnimFinished |= animFinished;
+
+    // if the task queue is full the work stays pending for the next tick
+    if (!_deferredQueued)
+        _deferredQueued = System.queueCallback(processDeferredCb);
+}
+
+void APPLedCtrl::processDeferredCb(uint32_t param) {
+    app.rgbwwctrl.processDeferred();
+}
+
+void APPLedCtrl::processDeferred() {
+    // everything due since the last run, several ticks may have passed
+    const uint32_t due = _deferredDue;
+    const uint32_t steps = _deferredSteps;
+    const bool animFinished = _deferredAnimFinished;
+    _deferredDue = 0;
+    _deferredSteps = 0;
+    _deferredAnimFinished = false;
+    _deferredQueued = false;
+    _tickStats.beginDeferred();
+    collectFinishedAnimations();
+
+    if (TickScheduler::isSet(due, TickScheduler::TaskClockMaster)) {
+        // the position at sending time, the task runs a bit after the tick
+        uint32_t phaseUs;
+        const uint32_t stepsNow = getStepPosition(phaseUs);
+        app.mqttclient.publishClock(stepsNow);
+        app.syncudp.publishClock(stepsNow, phaseUs);
+    }
+    _tickStats.stageDone(TickStats::StageClock);
 
     if (app.cfg.events.color_interval_ms >= 0) {
-        if (animFinished || app.cfg.events.color_interval_ms == 0 ||
-                ((stepLenMs * _stepCounter) % app.cfg.events.color_interval_ms) < stepLenMs) {
+        if (animFinished || TickScheduler::isSet(due, TickScheduler::TaskColorEvent)) {
 
             uint32_t now = millis();
             if (now - _lastColorEvent >= app.cfg.events.color_mininterval_ms) {
@@ -161,29 +260,32 @@ void APPLedCtrl::updateLed() {
             }
         }
     }
+    _tickStats.stageDone(TickStats::StageEvents);
 
-    if (animFinished || app.cfg.sync.color_master_interval_ms == 0 ||
-            ((stepLenMs * _stepCounter) % app.cfg.sync.color_master_interval_ms) < stepLenMs) {
+    if (animFinished || TickScheduler::isSet(due, TickScheduler::TaskColorMqtt)) {
         publishToMqtt();
     }
+    _tickStats.stageDone(TickStats::StageMqtt);
 
-    checkStableColorState();
+    checkStableColorState(steps);
+    if (!_idle)
+        mirrorState();
+    _tickStats.stageDone(TickStats::StageStableCheck);
 
-    if (app.cfg.events.transfin_interval_ms >= 0) {
-        if (app.cfg.events.transfin_interval_ms == 0 ||
-                ((stepLenMs * _stepCounter) % app.cfg.events.transfin_interval_ms) < stepLenMs) {
-            publishFinishedStepAnimations();
-        }
+    if (TickScheduler::isSet(due, TickScheduler::TaskTransitionFinished)) {
+        publishFinishedStepAnimations();
     }
+    _tickStats.stageDone(TickStats::StageTransFin);
 }
 
-void APPLedCtrl::checkStableColorState() {
+void APPLedCtrl::checkStableColorState(uint32_t steps) {
 	if (app.cfg.color.startup_color != "last")
 		return;
 
+    const uint32_t prevStableSteps = _numStableColorSteps;
     if (_prevColor == getCurrentColor())
     {
-        ++_numStableColorSteps;
+        _numStableColorSteps += steps;
     }
     else {
         _prevColor = getCurrentColor();
@@ -191,10 +293,117 @@ void APPLedCtrl::checkStableColorState() {
     }
 
     // save if color was stable for _saveAfterStableColorMs
-    if (abs(_saveAfterStableColorMs - (_numStableColorSteps * RGBWW_MINTIMEDIFF)) <= (RGBWW_MINTIMEDIFF / 2))
+    const uint32_t saveSteps = _saveAfterStableColorMs / RGBWW_MINTIMEDIFF;
+    if (prevStableSteps < saveSteps && _numStableColorSteps >= saveSteps)
         colorSave();
 }
 
+void APPLedCtrl::mirrorState() {
+    RtcState::State state;
+    memset(&state, 0, sizeof(state));
+
+    state.raw = (_mode == ColorMode::Raw) ? 1 : 0;
+    const HSVCT& c = getCurrentColor();
+    state.hsv[0] = c.h;
+    state.hsv[1] = c.s;
+    state.hsv[2] = c.v;
+    state.hsv[3] = c.ct;
+    const ChannelOutput& o = getCurrentOutput();
+    state.output[0] = o.r;
+    state.output[1] = o.g;
+    state.output[2] = o.b;
+    state.output[3] = o.ww;
+    state.output[4] = o.cw;
+
+    state.ease = 0xff;
+    if (_fadeEngine.isActive()) {
+        int from[5];
+        int delta[5];
+        _fadeEngine.getFrom(from);
+        _fadeEngine.getDelta(delta);
+        for(int i=0; i < 5; ++i) {
+            state.fadeFrom[i] = from[i];
+            state.fadeDelta[i] = delta[i];
+        }
+        state.ease = static_cast<uint8_t>(_fadeEngine.getEase());
+        state.fadeDirection = _fadeEngine.getDirection();
+        state.fadeSteps = _fadeEngine.getSteps();
+        state.fadeStep = _fadeEngine.getStep();
+    }
+
+    if (_animationPlayer.isPlaying()) {
+        strncpy(state.animation, _animationPlayer.getName().c_str(), sizeof(state.animation) - 1);
+        state.animationStep = _animationPlayer.getCurrentStep();
+    }
+
+    _rtcState.save(state);
+}
+
+bool APPLedCtrl::resumeState() {
+    RtcState::State state;
+    if (!_rtcState.load(state))
+        return false;
+
+    debug_i("APPLedCtrl::resumeState: resuming output from RTC memory");
+    int vals[5];
+    for(int i=0; i < 5; ++i)
+        vals[i] = state.raw ? state.output[i] : (i < 4 ? state.hsv[i] : 0);
+    applyColorDirect(state.raw != 0, vals);
+
+    if (state.animation[0] != '\0') {
+        String error;
+        _animationPlayer.play(state.animation, error, state.animationStep);
+    }
+    else if (state.ease != 0xff && state.fadeStep < state.fadeSteps) {
+        // continue the original curve instead of a new fade from the current values
+        int from[5];
+        int delta[5];
+        for(int i=0; i < 5; ++i) {
+            from[i] = state.fadeFrom[i];
+            delta[i] = state.fadeDelta[i];
+        }
+        _fadeEngine.resume(state.raw != 0, from, delta, state.fadeSteps, state.fadeStep,
+                static_cast<FadeEngine::Ease>(state.ease), state.fadeDirection, "");
+    }
+    return true;
+}
+
+void APPLedCtrl::checkIdle(uint32_t steps) {
+    if (_prevOutput == getCurrentOutput()) {
+        _numStableOutputSteps += steps;
+    }
+    else {
+        _prevOutput = getCurrentOutput();
+        _numStableOutputSteps = 0;
+    }
+
+    // slaves need every step to follow their master
+    const bool canIdle = !app.cfg.sync.clock_slave_enabled && !app.cfg.sync.color_slave_enabled &&
+            !_fadeEngine.isActive() && !_animationPlayer.isPlaying();
+
+    const bool idle = canIdle && _numStableOutputSteps >= _idleAfterSteps;
+    if (idle != _idle)
+        debug_d("APPLedCtrl::checkIdle: %s\n", idle ? "idle" : "active");
+    _idle = idle;
+}
+
+void APPLedCtrl::wake() {
+    _numStableOutputSteps = 0;
+    _idle = false;
+    if (_tickSteps == 1)
+        return;
+
+    // run the pending tick now, counting the steps elapsed since the last one
+    const uint32_t elapsed = micros() - _lastTickUs;
+    const uint32_t pendingSteps = std::min(elapsed / _timerInterval + 1, _tickSteps);
+    const uint32_t remaining = pendingSteps * _timerInterval - std::min(elapsed, pendingSteps * _timerInterval);
+
+    _tickSteps = pendingSteps;
+    _armedIntervalUs = elapsed + remaining;
+    ets_timer_disarm(&_ledTimer);
+    ets_timer_arm_new(&_ledTimer, std::max(remaining, 1u), 0, 0);
+}
+
 void APPLedCtrl::publishFinishedStepAnimations() {
     for(unsigned int i=0; i < _stepFinishedAnimations.count(); i++) {
         const String& name = _stepFinishedAnimations.keyAt(i);
@@ -207,17 +416,106 @@ void APPLedCtrl::publishFinishedStepAnimations() {
 
 void APPLedCtrl::onMasterClockReset() {
     _timerInterval = _stepSync->reset();
+    _syncTelemetry.reset();
     publishStatus();
 }
 
-void APPLedCtrl::onMasterClock(uint32_t stepsMaster) {
-    _timerInterval = _stepSync->onMasterClock(_stepCounter, stepsMaster);
+void APPLedCtrl::onMasterClock(uint32_t stepsMaster, int32_t masterPhaseUs) {
+    uint32_t phaseUs;
+    uint32_t stepsLocal = getStepPosition(phaseUs);
+
+    int32_t phaseErrorUs = 0;
+    if (masterPhaseUs >= 0) {
+        // sub-step error in (-1/2, 1/2] steps, positive if the master is ahead;
+        // near a step boundary the local step is the one of the master
+        const int32_t interval = static_cast<int32_t>(_timerInterval);
+        phaseErrorUs = std::min(masterPhaseUs, interval - 1) - static_cast<int32_t>(phaseUs);
+        if (phaseErrorUs > interval / 2) {
+            phaseErrorUs -= interval;
+            --stepsLocal;
+        }
+        else if (phaseErrorUs <= -interval / 2) {
+            phaseErrorUs += interval;
+            ++stepsLocal;
+        }
+
+        // shift the next tick once, it stays between 1/2 and 3/2 steps long
+        debug_d("APPLedCtrl::onMasterClock phase error %d us\n", phaseErrorUs);
+        _phaseCorrectionUs = -phaseErrorUs;
+    }
+
+    _timerInterval = _stepSync->onMasterClock(stepsLocal, stepsMaster, phaseErrorUs);
 
     // limit interval to sane values (just for safety)
-    _timerInterval = std::min(std::max(_timerInterval, RGBWW_MINTIMEDIFF_US / 2u), static_cast<uint32_t>(RGBWW_MINTIMEDIFF_US * 1.5));
+    _timerInterval = std::min(std::max(_timerInterval, RGBWW_MINTIMEDIFF_US / 2u), RGBWW_MINTIMEDIFF_US * 3u / 2u);
+    _syncTelemetry.addSample(stepsMaster, stepsLocal, _stepSync->getCatchupOffset(), phaseErrorUs, _timerInterval, masterPhaseUs >= 0);
     publishStatus();
 }
 
+uint32_t APPLedCtrl::getStepPosition(uint32_t& phaseUs) const {
+    // the step counter is the next step to render, in idle mode several
+    // steps pass until the next tick
+    const uint32_t elapsed = micros() - _lastTickUs;
+    phaseUs = elapsed % _timerInterval;
+    return _stepCounter + elapsed / _timerInterval;
+}
+
+void APPLedCtrl::onColorSyncSample(uint32_t stepsMaster, ColorSyncBuffer::Mode mode, const int vals[5]) {
+    if (app.cfg.sync.color_slave_buffer_steps == 0) {
+        _colorSync.reset();
+        applyColorSync(mode, vals);
+        return;
+    }
+
+    _colorSync.setDelay(app.cfg.sync.color_slave_buffer_steps);
+    _colorSync.onSample(_stepCounter, stepsMaster, mode, vals);
+}
+
+void APPLedCtrl::processColorSync() {
+    ColorSyncBuffer::Mode mode;
+    int vals[5];
+    if (_colorSync.process(_stepCounter, mode, vals))
+        applyColorSync(mode, vals);
+}
+
+void APPLedCtrl::applyColorSync(ColorSyncBuffer::Mode mode, const int vals[5]) {
+    applyColorDirect(mode == ColorSyncBuffer::Mode::Raw, vals);
+}
+
+void APPLedCtrl::processFade() {
+    int vals[5];
+    const bool finished = _fadeEngine.process(vals);
+    applyColorDirect(_fadeEngine.isRaw(), vals);
+
+    if (finished && _fadeEngine.getName().length() > 0)
+        addFinishedAnimation(_fadeEngine.getName(), false);
+}
+
+void APPLedCtrl::stopAppAnimations() {
+    _animationPlayer.stop();
+    _fadeEngine.stop();
+}
+
+void APPLedCtrl::applyColorDirect(bool raw, const int vals[5]) {
+    if (!raw) {
+        RequestHSVCT hsv;
+        hsv.h = AbsOrRelValue(vals[0]);
+        hsv.s = AbsOrRelValue(vals[1]);
+        hsv.v = AbsOrRelValue(vals[2]);
+        hsv.ct = AbsOrRelValue(vals[3]);
+        colorDirectHSV(hsv);
+    }
+    else {
+        RequestChannelOutput raw;
+        raw.r = AbsOrRelValue(vals[0]);
+        raw.g = AbsOrRelValue(vals[1]);
+        raw.b = AbsOrRelValue(vals[2]);
+        raw.ww = AbsOrRelValue(vals[3]);
+        raw.cw = AbsOrRelValue(vals[4]);
+        colorDirectRAW(raw);
+    }
+}
+
 void APPLedCtrl::publishStatus() {
     app.eventserver.publishClockSlaveStatus(_stepSync->getCatchupOffset(), _timerInterval);
     app.mqttclient.publishClockSlaveOffset(_stepSync->getCatchupOffset());
@@ -274,7 +572,29 @@ void APPLedCtrl::testChannels() {
 void APPLedCtrl::onAnimationFinished(const String& name, bool requeued) {
     debug_d("APPLedCtrl::onAnimationFinished: %s", name.c_str());
 
+    // steps of animation programs are internal
+    if (_animationPlayer.onAnimationFinished(name))
+        return;
+
     if (name.length() > 0) {
+        addFinishedAnimation(name, requeued);
+    }
+}
+
+void APPLedCtrl::addFinishedAnimation(const String& name, bool requeued) {
+    // long names and bursts beyond the buffer take the allocating path
+    if (name.length() >= sizeof(FinishedAnimation::name) || _numFinishedAnimations >= _maxFinishedAnimations) {
         _stepFinishedAnimations[name] = requeued;
+        return;
     }
+
+    FinishedAnimation& entry = _finishedAnimations[_numFinishedAnimations++];
+    memcpy(entry.name, name.c_str(), name.length() + 1);
+    entry.requeued = requeued;
+}
+
+void APPLedCtrl::collectFinishedAnimations() {
+    for(uint8_t i=0; i < _numFinishedAnimations; ++i)
+        _stepFinishedAnimations[_finishedAnimations[i].name] = _finishedAnimations[i].requeued;
+    _numFinishedAnimations = 0;
 }
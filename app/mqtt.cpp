@@ -92,9 +92,13 @@ void AppMqttClient::start() {
     debug_i("MqttClient: Server: %s Port: %d\n", app.cfg.network.mqtt.server.c_str(), app.cfg.network.mqtt.port);
     mqtt = new MqttClient(app.cfg.network.mqtt.server, app.cfg.network.mqtt.port, MqttStringSubscriptionCallback(&AppMqttClient::onMessageReceived, this));
     connectDelayed(2000);
+
+    _outboxTimer.initializeMs(app.cfg.network.mqtt.publish_interval_ms, TimerDelegate(&AppMqttClient::flushOutbox, this)).start();
 }
 
 void AppMqttClient::stop() {
+    _procTimer.stop();
+    _outboxTimer.stop();
     delete mqtt;
     mqtt = nullptr;
 }
@@ -105,6 +109,10 @@ bool AppMqttClient::isRunning() const {
 
 void AppMqttClient::onMessageReceived(String topic, String message) {
     if (app.cfg.sync.clock_slave_enabled && (topic == app.cfg.sync.clock_slave_topic)) {
+        if (app.syncudp.hasClock()) {
+            // the same clock arrives faster via UDP
+            return;
+        }
         if (message == "reset") {
             app.rgbwwctrl.onMasterClockReset();
         }
@@ -117,8 +125,15 @@ void AppMqttClient::onMessageReceived(String topic, String message) {
         app.jsonproc.onJsonRpc(message);
     }
     else if (app.cfg.sync.color_slave_enabled && (topic == app.cfg.sync.color_slave_topic)) {
-        String error;
-        app.jsonproc.onColor(message, error, false);
+        if (message.length() > 0 && message[0] == _colorFrameHexPrefix) {
+            uint8_t buf[_colorFrameMaxSize];
+            const size_t len = BinaryFrameHex::decode(message.c_str() + 1, message.length() - 1, buf, sizeof(buf));
+            onColorFrame(buf, len);
+        }
+        else {
+            String error;
+            app.jsonproc.onColor(message, error, false);
+        }
     }
 }
 
@@ -133,54 +148,120 @@ void AppMqttClient::publish(const String& topic, const String& data, bool retain
     TcpClientState state = mqtt->getConnectionState();
     if (state == TcpClientState::eTCS_Connected) {
         mqtt->publish(topic, data, retain);
+        ++_numPublished;
     }
     else {
         debug_w("ApplicationMQTTClient::publish: not connected.\n");
     }
 }
 
-void AppMqttClient::publishCurrentRaw(const ChannelOutput& raw) {
-    if (raw == _lastRaw)
+void AppMqttClient::queue(const String& topic, const String& data, bool retain) {
+    for(int i=0; i < _numOutbox; ++i) {
+        if (_outbox[i].topic == topic) {
+            _outbox[i].data = data;
+            _outbox[i].retain = retain;
+            ++_numCoalesced;
+            return;
+        }
+    }
+
+    if (_numOutbox >= _outboxSize) {
+        debug_w("ApplicationMQTTClient::queue: outbox full - dropping %s\n", topic.c_str());
+        ++_numDropped;
         return;
-    _lastRaw = raw;
+    }
 
-    debug_d("ApplicationMQTTClient::publishCurrentRaw\n");
+    _outbox[_numOutbox].topic = topic;
+    _outbox[_numOutbox].data = data;
+    _outbox[_numOutbox].retain = retain;
+    ++_numOutbox;
+}
 
-    DynamicJsonBuffer jsonBuffer(200);
-    JsonObject& root = jsonBuffer.createObject();
-    JsonObject& rawJson = root.createNestedObject("raw");
-    rawJson["r"] = raw.r;
-    rawJson["g"] = raw.g;
-    rawJson["b"] = raw.b;
-    rawJson["cw"] = raw.cw;
-    rawJson["ww"] = raw.ww;
+void AppMqttClient::flushOutbox() {
+    if (!mqtt || mqtt->getConnectionState() != TcpClientState::eTCS_Connected)
+        return;
 
-    root["t"] = 0;
-    root["cmd"] = "solid";
+    flushColor();
 
-    String jsonMsg;
-    root.printTo(jsonMsg);
-    publish(buildTopic("color"), jsonMsg, true);
+    for(int i=0; i < _numOutbox; ++i) {
+        publish(_outbox[i].topic, _outbox[i].data, _outbox[i].retain);
+        _outbox[i].data = "";
+    }
+    _numOutbox = 0;
+}
+
+void AppMqttClient::getOutboxStats(JsonObject& root) const {
+    root["published"] = _numPublished;
+    root["coalesced"] = _numCoalesced;
+    root["dropped"] = _numDropped;
+}
+
+void AppMqttClient::publishCurrentRaw(const ChannelOutput& raw) {
+    if (raw == _lastRaw && _pendingColor != PendingColor::Hsv)
+        return;
+    _lastRaw = raw;
+
+    // serialized when the outbox is flushed
+    if (_pendingColor != PendingColor::None)
+        ++_numCoalesced;
+    _pendingColor = PendingColor::Raw;
+    _pendingStep = app.rgbwwctrl.getStepCounter();
 }
 
 void AppMqttClient::publishCurrentHsv(const HSVCT& color) {
-    if (color == _lastHsv)
+    if (color == _lastHsv && _pendingColor != PendingColor::Raw)
         return;
     _lastHsv = color;
 
-    debug_d("ApplicationMQTTClient::publishCurrentHsv\n");
+    if (_pendingColor != PendingColor::None)
+        ++_numCoalesced;
+    _pendingColor = PendingColor::Hsv;
+    _pendingStep = app.rgbwwctrl.getStepCounter();
+}
+
+void AppMqttClient::flushColor() {
+    if (_pendingColor == PendingColor::None)
+        return;
+
+    if (app.cfg.sync.color_master_binary) {
+        const HSVCT* pHsv = _pendingColor == PendingColor::Hsv ? &_lastHsv : NULL;
+        uint8_t buf[_colorFrameMaxSize];
+        const size_t len = buildColorFrame(buf, _pendingStep, pHsv, _lastRaw);
 
-    float h, s, v;
-    int ct;
-    color.asRadian(h, s, v, ct);
+        char text[2 + 2 * _colorFrameMaxSize];
+        text[0] = _colorFrameHexPrefix;
+        BinaryFrameHex::encode(buf, len, text + 1);
+        publish(buildTopic("color"), text, true);
+        _pendingColor = PendingColor::None;
+        return;
+    }
 
     DynamicJsonBuffer jsonBuffer(200);
     JsonObject& root = jsonBuffer.createObject();
-    JsonObject& hsv = root.createNestedObject("hsv");
-    hsv["h"] = h;
-    hsv["s"] = s;
-    hsv["v"] = v;
-    hsv["ct"] = ct;
+
+    if (_pendingColor == PendingColor::Hsv) {
+        debug_d("ApplicationMQTTClient::publishCurrentHsv\n");
+
+        float h, s, v;
+        int ct;
+        _lastHsv.asRadian(h, s, v, ct);
+
+        JsonObject& hsv = root.createNestedObject("hsv");
+        hsv["h"] = h;
+        hsv["s"] = s;
+        hsv["v"] = v;
+        hsv["ct"] = ct;
+    }
+    else {
+        debug_d("ApplicationMQTTClient::publishCurrentRaw\n");
+
+        JsonObject& rawJson = root.createNestedObject("raw");
+        rawJson["r"] = _lastRaw.r;
+        rawJson["g"] = _lastRaw.g;
+        rawJson["b"] = _lastRaw.b;
+        rawJson["cw"] = _lastRaw.cw;
+        rawJson["ww"] = _lastRaw.ww;
+    }
 
     root["t"] = 0;
     root["cmd"] = "solid";
@@ -188,6 +269,61 @@ void AppMqttClient::publishCurrentHsv(const HSVCT& color) {
     String jsonMsg;
     root.printTo(jsonMsg);
     publish(buildTopic("color"), jsonMsg, true);
+    _pendingColor = PendingColor::None;
+}
+
+size_t AppMqttClient::buildColorFrame(uint8_t* pBuf, uint32_t steps, const HSVCT* pHsv, const ChannelOutput& raw) {
+    BinaryFrameWriter frame(pBuf, _colorFrameMaxSize);
+    frame.put8(_colorFrameMagic);
+
+    if (pHsv) {
+        frame.put8(ColorFrameHsv);
+        frame.put32(steps);
+        frame.put16(pHsv->h);
+        frame.put16(pHsv->s);
+        frame.put16(pHsv->v);
+        frame.put16(pHsv->ct);
+    }
+    else {
+        frame.put8(ColorFrameRaw);
+        frame.put32(steps);
+        frame.putPacked10(raw.r, raw.g, raw.b, raw.ww, raw.cw);
+    }
+
+    return frame.getLength();
+}
+
+void AppMqttClient::onColorFrame(const uint8_t* pData, size_t len) {
+    BinaryFrameReader frame(pData, len);
+    frame.get8();
+    const uint8_t mode = frame.get8();
+    const uint32_t stepsMaster = frame.get32();
+
+    int vals[5] = { 0 };
+    ColorSyncBuffer::Mode syncMode;
+    if (mode == ColorFrameHsv) {
+        syncMode = ColorSyncBuffer::Mode::Hsv;
+        for(int i=0; i < 4; ++i)
+            vals[i] = frame.get16();
+    }
+    else if (mode == ColorFrameRaw) {
+        syncMode = ColorSyncBuffer::Mode::Raw;
+        uint16_t packed[5];
+        frame.getPacked10(packed);
+        for(int i=0; i < 5; ++i)
+            vals[i] = packed[i];
+    }
+    else {
+        debug_w("AppMqttClient::onColorFrame: unknown mode %d\n", mode);
+        return;
+    }
+
+    if (!frame.isValid()) {
+        debug_w("AppMqttClient::onColorFrame: frame too short (%d bytes)\n", len);
+        return;
+    }
+
+    app.rgbwwctrl.onColorSyncSample(stepsMaster, syncMode, vals);
 }
 
 String AppMqttClient::buildTopic(const String& suffix) {
@@ -217,14 +353,14 @@ void AppMqttClient::publishClockInterval(uint32_t curInterval) {
     String msg;
     msg += curInterval;
 
-    publish(buildTopic("clock_interval"), msg, false);
+    queue(buildTopic("clock_interval"), msg, false);
 }
 
 void AppMqttClient::publishClockSlaveOffset(uint32_t offset) {
     String msg;
     msg += offset;
 
-    publish(buildTopic("clock_slave_offset"), msg, false);
+    queue(buildTopic("clock_slave_offset"), msg, false);
 }
 
 void AppMqttClient::publishCommand(const String& method, const JsonObject& params) {
@@ -240,6 +376,18 @@ void AppMqttClient::publishCommand(const String& method, const JsonObject& param
     publish(buildTopic("command"), msgStr, false);
 }
 
+void AppMqttClient::publishCommand(const String& method, const String& paramsJson) {
+    debug_d("ApplicationMQTTClient::publishCommand: %s\n", method.c_str());
+
+    // the params are relayed as received, no need to parse them again
+    String msgStr = "{\"jsonrpc\":\"2.0\",\"method\":\"";
+    msgStr += method;
+    msgStr += "\",\"params\":";
+    msgStr += paramsJson;
+    msgStr += "}";
+    publish(buildTopic("command"), msgStr, false);
+}
+
 void AppMqttClient::publishTransitionFinished(const String& name, bool requeued) {
     debug_d("ApplicationMQTTClient::publishTransitionFinished: %s\n", name.c_str());
 
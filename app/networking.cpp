@@ -105,25 +105,41 @@ void AppWIFI::init() {
     } else {
 
         //configure WifiClient
-        if (!app.cfg.network.connection.dhcp && !app.cfg.network.connection.ip.isNull()) {
-            debug_i("AppWIFI::init setting static ip");
-            if (WifiStation.isEnabledDHCP()) {
-                debug_i("AppWIFI::init disabled dhcp");
-                WifiStation.enableDHCP(false);
-            }
-            if (!(WifiStation.getIP() == app.cfg.network.connection.ip)
-                    || !(WifiStation.getNetworkGateway() == app.cfg.network.connection.gateway)
-                    || !(WifiStation.getNetworkMask() == app.cfg.network.connection.netmask)) {
-                debug_i("AppWIFI::init updating ip configuration");
-                WifiStation.setIP(app.cfg.network.connection.ip,app.cfg.network.connection.netmask,app.cfg.network.connection.gateway);
-            }
-        } else {
-            debug_i("AppWIFI::init dhcp");
-            if (!WifiStation.isEnabledDHCP()) {
-                debug_i("AppWIFI::init enabling dhcp");
-                WifiStation.enableDHCP(true);
-            }
+        applyIpConfig();
+    }
+}
+
+void AppWIFI::applyIpConfig() {
+    if (!app.cfg.network.connection.dhcp && !app.cfg.network.connection.ip.isNull()) {
+        debug_i("AppWIFI::applyIpConfig setting static ip");
+        if (WifiStation.isEnabledDHCP()) {
+            debug_i("AppWIFI::applyIpConfig disabled dhcp");
+            WifiStation.enableDHCP(false);
         }
+        if (!(WifiStation.getIP() == app.cfg.network.connection.ip)
+                || !(WifiStation.getNetworkGateway() == app.cfg.network.connection.gateway)
+                || !(WifiStation.getNetworkMask() == app.cfg.network.connection.netmask)) {
+            debug_i("AppWIFI::applyIpConfig updating ip configuration");
+            WifiStation.setIP(app.cfg.network.connection.ip,app.cfg.network.connection.netmask,app.cfg.network.connection.gateway);
+        }
+    } else {
+        debug_i("AppWIFI::applyIpConfig dhcp");
+        if (!WifiStation.isEnabledDHCP()) {
+            debug_i("AppWIFI::applyIpConfig enabling dhcp");
+            WifiStation.enableDHCP(true);
+        }
+    }
+}
+
+void AppWIFI::applyApConfig() {
+    if (!WifiAccessPoint.isEnabled())
+        return;
+
+    debug_i("AppWIFI::applyApConfig");
+    if (app.cfg.network.ap.secured) {
+        WifiAccessPoint.config(app.cfg.network.ap.ssid, app.cfg.network.ap.password, AUTH_WPA2_PSK);
+    } else {
+        WifiAccessPoint.config(app.cfg.network.ap.ssid, "", AUTH_OPEN);
     }
 }
 
@@ -181,6 +197,9 @@ void AppWIFI::_STAGotIP(IPAddress ip, IPAddress mask, IPAddress gateway) {
     if(app.cfg.network.mqtt.enabled) {
         app.mqttclient.start();
     }
+
+    // joining the multicast group needs the station ip
+    app.syncudp.start();
 }
 
 void AppWIFI::stopAp(int delay) {
@@ -70,12 +70,30 @@ void ApplicationOTA::afterOTA() {
     debug_i("ApplicationOTA::afterOTA");
     if (status == OTASTATUS::OTA_SUCCESS_REBOOT) {
 
+        // copy the stored animation programs one by one, only one filesystem
+        // can be mounted at a time
+        Vector<String> programs;
+        AnimationProgram::list(programs);
+        static AnimationProgram program;
+        for(unsigned int i=0; i < programs.count(); ++i) {
+            if (!program.load(programs[i]))
+                continue;
+            app.umountfs();
+            app.mountfs(rom_slot);
+            if (!program.save(programs[i]))
+                debug_e("ApplicationOTA::afterOTA could not copy animation %s", programs[i].c_str());
+            app.umountfs();
+            app.mountfs(app.getRomSlot());
+        }
+        program.clear();
+
         // unmount old Filesystem - mount new filesystem
         app.umountfs();
         app.mountfs(rom_slot);
 
-        // save settings / color into new rom space
-        app.cfg.save();
+        // save settings / color into new rom space, the new filesystem has
+        // none of the sections the stored CRCs refer to
+        app.cfg.save(false, true);
         app.rgbwwctrl.colorSave();
 
         // save success to new rom
@@ -0,0 +1,36 @@
+#include <RGBWWCtrl.h>
+
+
+uint32_t RtcState::calcChecksum(const State& state) {
+    // FNV-1a
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(&state);
+    uint32_t hash = 2166136261u;
+    for(size_t i=0; i < sizeof(State); ++i) {
+        hash ^= pData[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool RtcState::load(State& state) {
+    if (!system_rtc_mem_read(_firstBlock, &_block, sizeof(Block)))
+        return false;
+
+    _valid = _block.magic == _magic && _block.checksum == calcChecksum(_block.state);
+    if (!_valid)
+        return false;
+
+    _block.state.animation[sizeof(_block.state.animation) - 1] = '\0';
+    state = _block.state;
+    return true;
+}
+
+void RtcState::save(const State& state) {
+    if (_valid && memcmp(&state, &_block.state, sizeof(State)) == 0)
+        return;
+
+    _block.magic = _magic;
+    _block.state = state;
+    _block.checksum = calcChecksum(state);
+    _valid = system_rtc_mem_write(_firstBlock, &_block, sizeof(Block));
+}
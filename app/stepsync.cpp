@@ -2,14 +2,19 @@
 #include <algorithm>
 
 
+int StepSync::getCatchupOffset() const {
+    return _catchupOffset;
+}
+
+
 uint32_t ClockCatchUp::reset() {
     _firstMasterSync = true;
     _catchupOffset = 0;
-    _steering = 1.0;
+    _steering = _steeringOne;
     return _constBaseInt;
 }
 
-uint32_t ClockCatchUp::onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster) {
+uint32_t ClockCatchUp::onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster, int32_t phaseErrorUs) {
     uint32_t nextInt = _constBaseInt;
     if (!_firstMasterSync) {
         int diff = StepSync::calcOverflowVal(_stepsSyncLast, stepsCurrent);
@@ -19,11 +24,13 @@ uint32_t ClockCatchUp::onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster
         _catchupOffset += curOffset;
         debug_d("Diff: %d | Master Diff: %d | CurOffset: %d | Catchup Offset: %d\n", diff, masterDiff, curOffset, _catchupOffset);
 
-        float curSteering = 1.0 - static_cast<float>(_catchupOffset) / masterDiff;
-        curSteering = std::min(std::max(curSteering, 0.5f), 1.5f);
-        _steering = 0.5f *_steering + 0.5f * curSteering;
-        nextInt *= _steering;
-        debug_d("New Int: %d | CurSteering: %f | Steering: %f\n", nextInt, curSteering, _steering);
+        int32_t curSteering = _steeringOne;
+        if (masterDiff > 0)
+            curSteering -= static_cast<int32_t>(static_cast<int64_t>(_catchupOffset) * _steeringOne / masterDiff);
+        curSteering = std::min(std::max(curSteering, _steeringOne / 2), _steeringOne * 3 / 2);
+        _steering = (_steering + curSteering) / 2;
+        nextInt = (nextInt * static_cast<uint32_t>(_steering)) >> 16;
+        debug_d("New Int: %d | CurSteering: %d | Steering: %d (1/65536)\n", nextInt, curSteering, _steering);
     }
 
     _stepsSyncMasterLast = stepsMaster;
@@ -37,3 +44,47 @@ int ClockCatchUp::getCatchupOffset() const {
     return _catchupOffset;
 }
 
+
+uint32_t ClockPI::reset() {
+    _firstMasterSync = true;
+    _catchupOffset = 0;
+    _freq = 0;
+    return _constBaseInt;
+}
+
+uint32_t ClockPI::onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster, int32_t phaseErrorUs) {
+    uint32_t nextInt = _constBaseInt;
+    if (!_firstMasterSync) {
+        int diff = StepSync::calcOverflowVal(_stepsSyncLast, stepsCurrent);
+        int masterDiff = StepSync::calcOverflowVal(_stepsSyncMasterLast, stepsMaster);
+
+        int curOffset = masterDiff - diff;
+        _catchupOffset += curOffset;
+        debug_d("Diff: %d | Master Diff: %d | CurOffset: %d | Catchup Offset: %d\n", diff, masterDiff, curOffset, _catchupOffset);
+
+        if (masterDiff > 0) {
+            // phase error relative to the sync interval
+            const int32_t error = static_cast<int32_t>(static_cast<int64_t>(_catchupOffset) * _steeringOne / masterDiff);
+            const int32_t phaseError = static_cast<int32_t>(static_cast<int64_t>(phaseErrorUs) * _steeringOne /
+                    (static_cast<int64_t>(masterDiff) * _constBaseInt));
+
+            _freq += (error >> _kiShift) + (phaseError >> _kfShift);
+            _freq = std::min(std::max(_freq, -_maxFreq), _maxFreq);
+
+            int32_t steering = _steeringOne - _freq - (error >> _kpShift);
+            steering = std::min(std::max(steering, _steeringOne / 2), _steeringOne * 3 / 2);
+            nextInt = (nextInt * static_cast<uint32_t>(steering)) >> 16;
+            debug_d("New Int: %d | Error: %d | Freq: %d (1/65536)\n", nextInt, error, _freq);
+        }
+    }
+
+    _stepsSyncMasterLast = stepsMaster;
+    _stepsSyncLast = stepsCurrent;
+    _firstMasterSync = false;
+
+    return nextInt;
+}
+
+int ClockPI::getCatchupOffset() const {
+    return _catchupOffset;
+}
@@ -0,0 +1,108 @@
+#include <RGBWWCtrl.h>
+#include <algorithm>
+
+
+SyncTelemetry::SyncTelemetry() {
+    reset();
+}
+
+void SyncTelemetry::reset() {
+    _next = 0;
+    _numTotal = 0;
+    _startMs = 0;
+    _convergedMs = 0;
+    _converged = false;
+    _offsetSum = 0;
+    _offsetMax = 0;
+    _jitterMax = 0;
+    _phaseErrorSum = 0;
+    _numPhase = 0;
+}
+
+void SyncTelemetry::addSample(uint32_t stepsMaster, uint32_t stepsLocal, int32_t offset, int32_t phaseErrorUs,
+        uint32_t intervalUs, bool udp) {
+    const uint32_t now = millis();
+
+    int32_t jitterMs = 0;
+    if (_numTotal > 0) {
+        const Sample& prev = _samples[(_next + _numSamples - 1) % _numSamples];
+        const uint32_t masterMs = (stepsMaster - prev.stepsMaster) * (RGBWW_MINTIMEDIFF_US / 1000);
+        jitterMs = static_cast<int32_t>((now - prev.timeMs) - masterMs);
+    }
+    else {
+        _startMs = now;
+    }
+
+    Sample& sample = _samples[_next];
+    sample.timeMs = now;
+    sample.stepsMaster = stepsMaster;
+    sample.stepsLocal = stepsLocal;
+    sample.offset = offset;
+    sample.phaseErrorUs = phaseErrorUs;
+    sample.jitterMs = jitterMs;
+    sample.intervalUs = intervalUs;
+    sample.udp = udp;
+    _next = (_next + 1) % _numSamples;
+    ++_numTotal;
+
+    const int32_t absOffset = offset >= 0 ? offset : -offset;
+    const int32_t absJitter = jitterMs >= 0 ? jitterMs : -jitterMs;
+    _offsetSum += absOffset;
+    if (absOffset > _offsetMax)
+        _offsetMax = absOffset;
+    if (absJitter > _jitterMax)
+        _jitterMax = absJitter;
+    if (udp) {
+        _phaseErrorSum += phaseErrorUs >= 0 ? phaseErrorUs : -phaseErrorUs;
+        ++_numPhase;
+    }
+
+    // converged from the first sample of the last run within the limit
+    if (absOffset > _convergedSteps) {
+        _converged = false;
+    }
+    else if (!_converged) {
+        _converged = true;
+        _convergedMs = now - _startMs;
+    }
+}
+
+void SyncTelemetry::toJson(JsonObject& root, uint32_t maxSamples) const {
+    root["count"] = _numTotal;
+    root["mean_offset"] = _numTotal > 0 ? static_cast<float>(_offsetSum) / _numTotal : 0.0f;
+    root["max_offset"] = _offsetMax;
+    root["max_jitter_ms"] = _jitterMax;
+    root["mean_phase_error_us"] = _numPhase > 0 ? _phaseErrorSum / _numPhase : 0;
+    root["converged_ms"] = _converged ? static_cast<int32_t>(_convergedMs) : -1;
+
+    JsonArray& columns = root.createNestedArray("columns");
+    columns.add("age_ms");
+    columns.add("master_steps");
+    columns.add("local_steps");
+    columns.add("offset");
+    columns.add("interval_us");
+    columns.add("steering_ppm");
+    columns.add("jitter_ms");
+    columns.add("phase_error_us");
+    columns.add("source");
+
+    // compact rows in the order of columns, oldest first
+    const uint32_t now = millis();
+    JsonArray& samples = root.createNestedArray("samples");
+    const uint32_t num = std::min(getNumSamples(), maxSamples);
+    for(uint32_t i=0; i < num; ++i) {
+        const Sample& sample = _samples[(_next + _numSamples - num + i) % _numSamples];
+        JsonArray& row = samples.createNestedArray();
+        row.add(now - sample.timeMs);
+        row.add(sample.stepsMaster);
+        row.add(sample.stepsLocal);
+        row.add(sample.offset);
+        row.add(sample.intervalUs);
+        // the interval is at most 3/2 steps, so this cannot overflow
+        row.add((static_cast<int32_t>(sample.intervalUs) - static_cast<int32_t>(RGBWW_MINTIMEDIFF_US)) *
+                static_cast<int32_t>(1000000 / RGBWW_MINTIMEDIFF_US));
+        row.add(sample.jitterMs);
+        row.add(sample.phaseErrorUs);
+        row.add(sample.udp ? "udp" : "mqtt");
+    }
+}
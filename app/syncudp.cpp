@@ -0,0 +1,204 @@
+#include <RGBWWCtrl.h>
+#include <algorithm>
+
+
+SyncUdp::~SyncUdp() {
+    stop();
+}
+
+void SyncUdp::start() {
+    stop();
+
+    const struct ApplicationSettings::sync& cfg = app.cfg.sync;
+    if (!cfg.udp_enabled)
+        return;
+
+    _group = cfg.udp_group;
+    if (_group.isNull()) {
+        debug_e("SyncUdp::start: invalid group %s\n", cfg.udp_group.c_str());
+        return;
+    }
+
+    debug_i("SyncUdp::start %s:%d\n", cfg.udp_group.c_str(), cfg.udp_port);
+    _udp = new UdpConnection(UdpConnectionDataDelegate(&SyncUdp::onReceive, this));
+
+    const bool slave = cfg.clock_slave_enabled || cfg.color_slave_enabled;
+    if (slave) {
+        ip_addr_t group;
+        group.addr = static_cast<uint32_t>(_group);
+        _joined = igmp_joingroup(IP_ADDR_ANY, &group) == ERR_OK;
+        if (!_joined)
+            debug_e("SyncUdp::start: joining %s failed\n", cfg.udp_group.c_str());
+        _udp->listen(cfg.udp_port);
+    }
+
+    _txEpoch = os_random();
+    _txSeq = 0;
+    _firstClock = true;
+    _rxSeqValid = false;
+    _clockReceived = false;
+    _lastColorFrameLen = 0;
+}
+
+void SyncUdp::stop() {
+    if (_joined) {
+        ip_addr_t group;
+        group.addr = static_cast<uint32_t>(_group);
+        igmp_leavegroup(IP_ADDR_ANY, &group);
+        _joined = false;
+    }
+
+    delete _udp;
+    _udp = nullptr;
+}
+
+void SyncUdp::send(PacketType type, const uint8_t* pPayload, size_t len) {
+    if (!_udp)
+        return;
+
+    uint8_t buf[_headerSize + _maxPayloadSize];
+    BinaryFrameWriter frame(buf, sizeof(buf));
+    frame.put8('R');
+    frame.put8('S');
+    frame.put8(_version);
+    frame.put8(type);
+    frame.put32(_txEpoch);
+    frame.put32(++_txSeq);
+    frame.put32(micros());
+    frame.putBytes(reinterpret_cast<const char*>(pPayload), len);
+
+    if (!frame.isValid()) {
+        debug_e("SyncUdp::send: payload too large (%d bytes)\n", len);
+        return;
+    }
+
+    _udp->sendTo(_group, app.cfg.sync.udp_port, reinterpret_cast<const char*>(frame.getData()), frame.getLength());
+    ++_numSent;
+}
+
+void SyncUdp::publishClock(uint32_t steps, uint32_t phaseUs) {
+    if (_firstClock) {
+        publishClockReset();
+        _firstClock = false;
+        return;
+    }
+
+    uint8_t payload[6];
+    BinaryFrameWriter frame(payload, sizeof(payload));
+    frame.put32(steps);
+    frame.put16(phaseUs);
+    send(PacketClock, frame.getData(), frame.getLength());
+}
+
+void SyncUdp::publishClockReset() {
+    send(PacketClockReset, nullptr, 0);
+}
+
+void SyncUdp::publishColor(uint32_t steps, const HSVCT* pHsv, const ChannelOutput& raw) {
+    if (!_udp)
+        return;
+
+    // compare without the step counter, the mode is implied by the length
+    uint8_t colorFrame[AppMqttClient::_colorFrameMaxSize];
+    const size_t len = AppMqttClient::buildColorFrame(colorFrame, steps, pHsv, raw);
+    const uint32_t now = millis();
+    const bool changed = len != _lastColorFrameLen || memcmp(colorFrame + 6, _lastColorFrame + 6, len - 6) != 0;
+    if (!changed && now - _lastColorMs < _colorRepeatMs)
+        return;
+
+    memcpy(_lastColorFrame, colorFrame, len);
+    _lastColorFrameLen = len;
+    _lastColorMs = now;
+    send(PacketColor, colorFrame, len);
+}
+
+bool SyncUdp::hasClock() const {
+    if (!_clockReceived)
+        return false;
+
+    // a few lost packets do not switch back to MQTT
+    const uint32_t timeout = 3 * std::max(_clockIntervalMs, 1000u);
+    return millis() - _lastClockMs < timeout;
+}
+
+void SyncUdp::onReceive(UdpConnection& connection, char* data, int size, IPAddress remoteIP, uint16_t remotePort) {
+    BinaryFrameReader frame(reinterpret_cast<const uint8_t*>(data), size);
+    const uint8_t magic0 = frame.get8();
+    const uint8_t magic1 = frame.get8();
+    const uint8_t version = frame.get8();
+    const uint8_t type = frame.get8();
+    const uint32_t epoch = frame.get32();
+    const uint32_t seq = frame.get32();
+    frame.get32();
+    if (!frame.isValid() || magic0 != 'R' || magic1 != 'S' || version != _version) {
+        ++_numInvalid;
+        return;
+    }
+
+    // a new or restarted master (new epoch) starts a new sequence
+    if (_rxSeqValid && remoteIP == _rxSender && epoch != _rxEpoch)
+        ++_numRestarts;
+    else if (_rxSeqValid && remoteIP == _rxSender) {
+        const int32_t gap = static_cast<int32_t>(seq - _rxSeq);
+        if (gap <= 0) {
+            ++_numDuplicates;
+            return;
+        }
+        if (gap > 1)
+            _numLost += gap - 1;
+    }
+    _rxSender = remoteIP;
+    _rxEpoch = epoch;
+    _rxSeq = seq;
+    _rxSeqValid = true;
+    ++_numReceived;
+
+    const struct ApplicationSettings::sync& cfg = app.cfg.sync;
+    switch(type) {
+    case PacketClock:
+    {
+        const uint32_t steps = frame.get32();
+        if (!frame.isValid() || !cfg.clock_slave_enabled)
+            break;
+
+        // the latency in the LAN is small against a step, so it is ignored
+        const int32_t phaseUs = frame.getRemaining() >= 2 ? frame.get16() : -1;
+
+        const uint32_t now = millis();
+        if (_clockReceived)
+            _clockIntervalMs = now - _lastClockMs;
+        _lastClockMs = now;
+        _clockReceived = true;
+        app.rgbwwctrl.onMasterClock(steps, phaseUs);
+        break;
+    }
+    case PacketClockReset:
+        if (!cfg.clock_slave_enabled)
+            break;
+        _lastClockMs = millis();
+        _clockReceived = true;
+        app.rgbwwctrl.onMasterClockReset();
+        break;
+
+    case PacketColor:
+        if (cfg.color_slave_enabled) {
+            app.mqttclient.onColorFrame(frame.getCurrent(), frame.getRemaining());
+        }
+        break;
+
+    default:
+        ++_numInvalid;
+        break;
+    }
+}
+
+void SyncUdp::getStats(JsonObject& root) const {
+    root["running"] = isRunning();
+    root["sent"] = _numSent;
+    root["received"] = _numReceived;
+    root["lost"] = _numLost;
+    root["duplicates"] = _numDuplicates;
+    root["restarts"] = _numRestarts;
+    root["invalid"] = _numInvalid;
+    root["clock_active"] = hasClock();
+}
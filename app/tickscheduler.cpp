@@ -0,0 +1,48 @@
+#include <RGBWWCtrl.h>
+
+
+void TickScheduler::setInterval(Task task, int intervalMs) {
+    Entry& entry = _entries[task];
+    if (entry.intervalMs == intervalMs)
+        return;
+
+    entry.intervalMs = intervalMs;
+    entry.due = _nowMs + (intervalMs > 0 ? intervalMs : 0);
+    updateNextDue();
+}
+
+uint32_t TickScheduler::advance(uint32_t elapsedMs) {
+    _nowMs += elapsedMs;
+    if (!_hasTasks || static_cast<int32_t>(_nowMs - _nextDue) < 0)
+        return 0;
+
+    uint32_t mask = 0;
+    for(int i=0; i < TaskCount; ++i) {
+        Entry& entry = _entries[i];
+        if (entry.intervalMs < 0 || static_cast<int32_t>(_nowMs - entry.due) < 0)
+            continue;
+
+        mask |= (1 << i);
+
+        // the next deadline follows from the last one so it does not drift,
+        // deadlines missed (e.g. in idle mode) are skipped
+        entry.due += entry.intervalMs;
+        if (static_cast<int32_t>(_nowMs - entry.due) >= 0)
+            entry.due = _nowMs + entry.intervalMs;
+    }
+    updateNextDue();
+    return mask;
+}
+
+void TickScheduler::updateNextDue() {
+    _hasTasks = false;
+    for(int i=0; i < TaskCount; ++i) {
+        const Entry& entry = _entries[i];
+        if (entry.intervalMs < 0)
+            continue;
+
+        if (!_hasTasks || static_cast<int32_t>(entry.due - _nextDue) < 0)
+            _nextDue = entry.due;
+        _hasTasks = true;
+    }
+}
@@ -0,0 +1,132 @@
+#include <RGBWWCtrl.h>
+#include <algorithm>
+
+
+TickStats::TickStats() {
+    reset();
+}
+
+void TickStats::reset() {
+    memset(_histogram, 0, sizeof(_histogram));
+    memset(_stageSumUs, 0, sizeof(_stageSumUs));
+    memset(_stageMaxUs, 0, sizeof(_stageMaxUs));
+
+    _numTicks = 0;
+    _tickSumUs = 0;
+    _tickMaxUs = 0;
+    _jitterSumUs = 0;
+    _jitterMaxUs = 0;
+    _heapChangedTicks = 0;
+    _heapMaxDrop = 0;
+    _heapMin = 0;
+    _prevTickStart = 0;
+}
+
+void TickStats::beginTick(uint32_t expectedIntervalUs) {
+    _tickStart = micros();
+    _stageStart = _tickStart;
+    _heapStart = system_get_free_heap_size();
+
+    if (_prevTickStart != 0) {
+        const uint32_t actual = _tickStart - _prevTickStart;
+        const uint32_t jitter = (actual > expectedIntervalUs) ? (actual - expectedIntervalUs) : (expectedIntervalUs - actual);
+        _jitterSumUs += jitter;
+        _jitterMaxUs = std::max(_jitterMaxUs, jitter);
+    }
+    _prevTickStart = _tickStart;
+}
+
+void TickStats::stageDone(Stage stage) {
+    const uint32_t now = micros();
+    const uint32_t duration = now - _stageStart;
+    _stageSumUs[stage] += duration;
+    _stageMaxUs[stage] = std::max(_stageMaxUs[stage], duration);
+    _stageStart = now;
+}
+
+void TickStats::endTick() {
+    const uint32_t duration = micros() - _tickStart;
+    const uint32_t heapEnd = system_get_free_heap_size();
+
+    uint32_t bucket = duration / _bucketWidthUs;
+    if (bucket >= _numBuckets)
+        bucket = _numBuckets - 1;
+    ++_histogram[bucket];
+
+    ++_numTicks;
+    _tickSumUs += duration;
+    _tickMaxUs = std::max(_tickMaxUs, duration);
+
+    if (heapEnd != _heapStart) {
+        ++_heapChangedTicks;
+        if (heapEnd < _heapStart)
+            _heapMaxDrop = std::max(_heapMaxDrop, _heapStart - heapEnd);
+    }
+
+    if (_heapMin == 0 || heapEnd < _heapMin)
+        _heapMin = heapEnd;
+}
+
+void TickStats::beginDeferred() {
+    _stageStart = micros();
+}
+
+uint32_t TickStats::getPercentile(uint8_t percent) const {
+    if (_numTicks == 0)
+        return 0;
+
+    const uint32_t threshold = (static_cast<uint64_t>(_numTicks) * percent + 99) / 100;
+    uint32_t count = 0;
+    for(uint32_t i=0; i < _numBuckets; ++i) {
+        count += _histogram[i];
+        if (count >= threshold) {
+            // report the upper bound of the bucket
+            return (i + 1) * _bucketWidthUs;
+        }
+    }
+    return _numBuckets * _bucketWidthUs;
+}
+
+const char* TickStats::getStageName(Stage stage) {
+    switch(stage) {
+    case StageRender:
+        return "render";
+    case StageClock:
+        return "clock";
+    case StageEvents:
+        return "events";
+    case StageMqtt:
+        return "mqtt";
+    case StageStableCheck:
+        return "stable_check";
+    case StageTransFin:
+        return "transfin";
+    default:
+        return "unknown";
+    }
+}
+
+void TickStats::toJson(JsonObject& root) const {
+    root["ticks"] = _numTicks;
+    root["mean_us"] = _numTicks > 0 ? _tickSumUs / _numTicks : 0;
+    root["max_us"] = _tickMaxUs;
+    root["p50_us"] = getPercentile(50);
+    root["p90_us"] = getPercentile(90);
+    root["p99_us"] = getPercentile(99);
+
+    JsonObject& jitter = root.createNestedObject("jitter");
+    jitter["mean_us"] = _numTicks > 1 ? _jitterSumUs / (_numTicks - 1) : 0;
+    jitter["max_us"] = _jitterMaxUs;
+
+    JsonObject& heap = root.createNestedObject("heap");
+    heap["changed_ticks"] = _heapChangedTicks;
+    heap["max_drop"] = _heapMaxDrop;
+    heap["min_free"] = _heapMin;
+
+    JsonObject& stages = root.createNestedObject("stages");
+    for(int i=0; i < StageCount; ++i) {
+        JsonObject& stage = stages.createNestedObject(getStageName(static_cast<Stage>(i)));
+        stage["mean_us"] = _numTicks > 0 ? _stageSumUs[i] / _numTicks : 0;
+        stage["max_us"] = _stageMaxUs[i];
+    }
+}
@@ -56,6 +56,8 @@ void ApplicationWebserver::init() {
     addPath("/pause", HttpPathDelegate(&ApplicationWebserver::onPause, this));
     addPath("/continue", HttpPathDelegate(&ApplicationWebserver::onContinue, this));
     addPath("/blink", HttpPathDelegate(&ApplicationWebserver::onBlink, this));
+    addPath("/tickstats", HttpPathDelegate(&ApplicationWebserver::onTickStats, this));
+    addPath("/sync", HttpPathDelegate(&ApplicationWebserver::onSync, this));
     _init = true;
 }
 
@@ -278,8 +280,8 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
         //root.prettyPrintTo(Serial);
 
         bool ip_updated = false;
-        bool color_updated = false;
         bool ap_updated = false;
+        bool pins_updated = false;
         if (!root.success()) {
             sendApiCode(response, API_CODES::API_BAD_REQUEST, "no root object");
             return;
@@ -391,6 +393,9 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
                         app.cfg.network.mqtt.topic_base = root["network"]["mqtt"]["topic_base"].asString();
                     }
                 }
+                if (root["network"]["mqtt"]["publish_interval_ms"].success()) {
+                    app.cfg.network.mqtt.publish_interval_ms = root["network"]["mqtt"]["publish_interval_ms"];
+                }
             }
         }
 
@@ -400,50 +405,42 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
                 if (root["color"]["hsv"]["model"].success()) {
                     if (root["color"]["hsv"]["model"] != app.cfg.color.hsv.model) {
                         app.cfg.color.hsv.model = root["color"]["hsv"]["model"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["red"].success()) {
                     if (root["color"]["hsv"]["red"].as<float>() != app.cfg.color.hsv.red) {
                         app.cfg.color.hsv.red = root["color"]["hsv"]["red"].as<float>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["yellow"].success()) {
                     if (root["color"]["hsv"]["yellow"].as<float>() != app.cfg.color.hsv.yellow) {
                         app.cfg.color.hsv.yellow = root["color"]["hsv"]["yellow"].as<float>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["green"].success()) {
                     if (root["color"]["hsv"]["green"].as<float>() != app.cfg.color.hsv.green) {
                         app.cfg.color.hsv.green = root["color"]["hsv"]["green"].as<float>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["cyan"].success()) {
                     if (root["color"]["hsv"]["cyan"].as<float>() != app.cfg.color.hsv.cyan) {
                         app.cfg.color.hsv.cyan = root["color"]["hsv"]["cyan"].as<float>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["blue"].success()) {
                     if (root["color"]["hsv"]["blue"].as<float>() != app.cfg.color.hsv.blue) {
                         app.cfg.color.hsv.blue = root["color"]["hsv"]["blue"].as<float>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["hsv"]["magenta"].success()) {
                     if (root["color"]["hsv"]["magenta"].as<float>() != app.cfg.color.hsv.magenta) {
                         app.cfg.color.hsv.magenta = root["color"]["hsv"]["magenta"].as<float>();
-                        color_updated = true;
                     }
                 }
             }
             if (root["color"]["outputmode"].success()) {
                 if (root["color"]["outputmode"] != app.cfg.color.outputmode) {
                     app.cfg.color.outputmode = root["color"]["outputmode"].as<int>();
-                    color_updated = true;
                 }
             }
             if (root["color"]["startup_color"].success()) {
@@ -454,31 +451,26 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
                 if (root["color"]["brightness"]["red"].success()) {
                     if (root["color"]["brightness"]["red"].as<int>() != app.cfg.color.brightness.red) {
                         app.cfg.color.brightness.red = root["color"]["brightness"]["red"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["brightness"]["green"].success()) {
                     if (root["color"]["brightness"]["green"].as<int>() != app.cfg.color.brightness.green) {
                         app.cfg.color.brightness.green = root["color"]["brightness"]["green"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["brightness"]["blue"].success()) {
                     if (root["color"]["brightness"]["blue"].as<int>() != app.cfg.color.brightness.blue) {
                         app.cfg.color.brightness.blue = root["color"]["brightness"]["blue"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["brightness"]["ww"].success()) {
                     if (root["color"]["brightness"]["ww"].as<int>() != app.cfg.color.brightness.ww) {
                         app.cfg.color.brightness.ww = root["color"]["brightness"]["ww"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["brightness"]["cw"].success()) {
                     if (root["color"]["brightness"]["cw"].as<int>() != app.cfg.color.brightness.cw) {
                         app.cfg.color.brightness.cw = root["color"]["brightness"]["cw"].as<int>();
-                        color_updated = true;
                     }
                 }
             }
@@ -487,13 +479,11 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
                 if (root["color"]["colortemp"]["ww"].success()) {
                     if (root["color"]["colortemp"]["cw"].as<int>() != app.cfg.color.colortemp.ww) {
                         app.cfg.color.colortemp.ww = root["color"]["colortemp"]["ww"].as<int>();
-                        color_updated = true;
                     }
                 }
                 if (root["color"]["colortemp"]["cw"].success()) {
                     if (root["color"]["colortemp"]["cw"].as<int>() != app.cfg.color.colortemp.cw) {
                         app.cfg.color.colortemp.cw = root["color"]["colortemp"]["cw"].as<int>();
-                        color_updated = true;
                     }
                 }
             }
@@ -532,7 +522,10 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
                 app.cfg.general.device_name = root["general"]["device_name"].asString();
             }
             if (root["general"]["pin_config"].success()) {
-                app.cfg.general.pin_config = root["general"]["pin_config"].asString();
+                if (root["general"]["pin_config"] != app.cfg.general.pin_config) {
+                    app.cfg.general.pin_config = root["general"]["pin_config"].asString();
+                    pins_updated = true;
+                }
             }
         }
 
@@ -549,6 +542,9 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
             if (root["sync"]["clock_slave_topic"].success()) {
                 app.cfg.sync.clock_slave_topic = root["sync"]["clock_slave_topic"].asString();
             }
+            if (root["sync"]["clock_slave_controller"].success()) {
+                app.cfg.sync.clock_slave_controller = root["sync"]["clock_slave_controller"].asString();
+            }
             if (root["sync"]["cmd_master_enabled"].success()) {
                 app.cfg.sync.cmd_master_enabled = root["sync"]["cmd_master_enabled"];
             }
@@ -565,12 +561,28 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
             if (root["sync"]["color_master_interval_ms"].success()) {
                 app.cfg.sync.color_master_interval_ms = root["sync"]["color_master_interval_ms"];
             }
+            if (root["sync"]["color_master_binary"].success()) {
+                app.cfg.sync.color_master_binary = root["sync"]["color_master_binary"];
+            }
             if (root["sync"]["color_slave_enabled"].success()) {
                 app.cfg.sync.color_slave_enabled = root["sync"]["color_slave_enabled"];
             }
             if (root["sync"]["color_slave_topic"].success()) {
                 app.cfg.sync.color_slave_topic = root["sync"]["color_slave_topic"].asString();
             }
+            if (root["sync"]["color_slave_buffer_steps"].success()) {
+                app.cfg.sync.color_slave_buffer_steps = root["sync"]["color_slave_buffer_steps"];
+            }
+
+            if (root["sync"]["udp_enabled"].success()) {
+                app.cfg.sync.udp_enabled = root["sync"]["udp_enabled"];
+            }
+            if (root["sync"]["udp_group"].success()) {
+                app.cfg.sync.udp_group = root["sync"]["udp_group"].asString();
+            }
+            if (root["sync"]["udp_port"].success()) {
+                app.cfg.sync.udp_port = root["sync"]["udp_port"];
+            }
         }
 
         if (root["events"].success()) {
@@ -592,35 +604,19 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
 
         // update and save settings if we haven`t received any error until now
         if (!error) {
-            if (ip_updated) {
-                if (root["restart"].success()) {
-                    if (root["restart"] == true) {
-                        debug_i("ApplicationWebserver::onConfig ip settings changed - rebooting");
-                        app.delayedCMD("restart", 3000); // wait 3s to first send response
-                        //json["data"] = "restart";
-
-                    }
+            const bool restart = root["restart"].success() && root["restart"] == true;
+            if (pins_updated && restart) {
+                // the pwm pins can only be set up at boot
+                debug_i("ApplicationWebserver::onConfig pin config changed - rebooting");
+                app.delayedCMD("restart", 3000); // wait 3s to first send response
+            } else {
+                if ((ip_updated || ap_updated) && restart) {
+                    debug_i("ApplicationWebserver::onConfig network settings changed - applying");
+                    app.delayedCMD("apply_network", 3000); // wait 3s to first send response
                 }
-            };
-            if (ap_updated) {
-                if (root["restart"].success()) {
-                    if (root["restart"] == true && WifiAccessPoint.isEnabled()) {
-                        debug_i("ApplicationWebserver::onConfig wifiap settings changed - rebooting");
-                        app.delayedCMD("restart", 3000); // wait 3s to first send response
-                        //json["data"] = "restart";
-
-                    }
-                }
-            }
-            if (color_updated) {
-                debug_d("ApplicationWebserver::onConfig color settings changed - refreshing");
-
-                //refresh settings
-                app.rgbwwctrl.setup();
-
-                //refresh current output
-                app.rgbwwctrl.refresh();
 
+                // everything else is applied without a reboot
+                app.applyConfig(app.cfg.getChangedSections());
             }
             app.cfg.save();
             sendApiCode(response, API_CODES::API_SUCCESS);
@@ -656,6 +652,7 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
         mqtt["username"] = app.cfg.network.mqtt.username.c_str();
         mqtt["password"] = app.cfg.network.mqtt.password.c_str();
         mqtt["topic_base"] = app.cfg.network.mqtt.topic_base.c_str();
+        mqtt["publish_interval_ms"] = app.cfg.network.mqtt.publish_interval_ms;
 
         JsonObject& color = json.createNestedObject("color");
         color["outputmode"] = app.cfg.color.outputmode;
@@ -693,14 +690,20 @@ void ApplicationWebserver::onConfig(HttpRequest &request, HttpResponse &response
         sync["clock_master_interval"] = app.cfg.sync.clock_master_interval;
         sync["clock_slave_enabled"] = app.cfg.sync.clock_slave_enabled;
         sync["clock_slave_topic"] = app.cfg.sync.clock_slave_topic.c_str();
+        sync["clock_slave_controller"] = app.cfg.sync.clock_slave_controller.c_str();
         sync["cmd_master_enabled"] = app.cfg.sync.cmd_master_enabled;
         sync["cmd_slave_enabled"] = app.cfg.sync.cmd_slave_enabled;
         sync["cmd_slave_topic"] = app.cfg.sync.cmd_slave_topic.c_str();
 
         sync["color_master_enabled"] = app.cfg.sync.color_master_enabled;
         sync["color_master_interval_ms"] = app.cfg.sync.color_master_interval_ms;
+        sync["color_master_binary"] = app.cfg.sync.color_master_binary;
         sync["color_slave_enabled"] = app.cfg.sync.color_slave_enabled;
         sync["color_slave_topic"] = app.cfg.sync.color_slave_topic.c_str();
+        sync["color_slave_buffer_steps"] = app.cfg.sync.color_slave_buffer_steps;
+        sync["udp_enabled"] = app.cfg.sync.udp_enabled;
+        sync["udp_group"] = app.cfg.sync.udp_group.c_str();
+        sync["udp_port"] = app.cfg.sync.udp_port;
 
         JsonObject& events = json.createNestedObject("events");
         events["color_interval_ms"] = app.cfg.events.color_interval_ms;
@@ -743,6 +746,10 @@ void ApplicationWebserver::onInfo(HttpRequest &request, HttpResponse &response)
     data["webapp_version"] = WEBAPP_VERSION;
     data["sming"] = SMING_VERSION;
     data["event_num_clients"] = app.eventserver.activeClients;
+    JsonObject& mqtt = data.createNestedObject("mqtt");
+    app.mqttclient.getOutboxStats(mqtt);
+    JsonObject& udp = data.createNestedObject("sync_udp");
+    app.syncudp.getStats(udp);
     data["uptime"] = app.getUptime();
     data["heap_free"] = system_get_free_heap_size();
 
@@ -801,7 +808,24 @@ void ApplicationWebserver::onColorPost(HttpRequest &request, HttpResponse &respo
     }
 
     String msg;
-    if (!app.jsonproc.onColor(body, msg)) {
+    JsonObjectStream* stream = new JsonObjectStream();
+    JsonObject& json = stream->getRoot();
+    JsonArray& results = json.createNestedArray("results");
+
+    const bool success = app.jsonproc.onColor(body, msg, true, &results);
+
+    // batches report the result of each command
+    if (results.size() > 0) {
+        if (success)
+            json["success"] = true;
+        else
+            json["error"] = msg;
+        sendApiResponse(response, stream, success ? 200 : 400);
+        return;
+    }
+
+    delete stream;
+    if (!success) {
         sendApiCode(response, API_CODES::API_BAD_REQUEST, msg);
     }
     else {
@@ -850,24 +874,38 @@ void ApplicationWebserver::onAnimation(HttpRequest &request, HttpResponse &respo
         return;
     }
 
-    bool error = false;
     if (request.method == HTTP_POST) {
         String body = request.getBody();
-        if (body == NULL || body.length() > 128) {
-            sendApiCode(response, API_CODES::API_BAD_REQUEST, "could not get HTTP body or body too long");
+        if (body == NULL) {
+            sendApiCode(response, API_CODES::API_BAD_REQUEST, "could not get HTTP body");
             return;
+        }
 
-        } else {
-
-            DynamicJsonBuffer jsonBuffer;
-            JsonObject& root = jsonBuffer.parseObject(body);
-            //root.prettyPrintTo(Serial);
+        String msg;
+        if (!app.jsonproc.onAnimation(body, msg)) {
+            sendApiCode(response, API_CODES::API_BAD_REQUEST, msg);
+            return;
         }
         sendApiCode(response, API_CODES::API_SUCCESS);
     } else {
+        if (!app.isFilesystemMounted()) {
+            sendApiCode(response, API_CODES::API_BAD_REQUEST, "No filesystem mounted");
+            return;
+        }
+
         JsonObjectStream* stream = new JsonObjectStream();
         JsonObject& json = stream->getRoot();
 
+        Vector<String> names;
+        AnimationProgram::list(names);
+        JsonArray& programs = json.createNestedArray("animations");
+        for(unsigned int i=0; i < names.count(); ++i)
+            programs.add(names[i]);
+
+        AnimationPlayer& player = app.rgbwwctrl.getAnimationPlayer();
+        if (player.isPlaying())
+            json["playing"] = player.getName();
+
         sendApiResponse(response, stream);
     }
 
@@ -1218,6 +1256,55 @@ void ApplicationWebserver::onBlink(HttpRequest &request, HttpResponse &response)
     }
 }
 
+void ApplicationWebserver::onTickStats(HttpRequest &request, HttpResponse &response) {
+    if (!authenticated(request, response)) {
+        return;
+    }
+
+    if (request.method != HTTP_POST && request.method != HTTP_GET) {
+        sendApiCode(response, API_CODES::API_BAD_REQUEST, "not POST or GET");
+        return;
+    }
+
+    // POST resets the statistics to start a new measurement
+    if (request.method == HTTP_POST) {
+        app.rgbwwctrl.getTickStats().reset();
+        sendApiCode(response, API_CODES::API_SUCCESS);
+        return;
+    }
+
+    JsonObjectStream* stream = new JsonObjectStream();
+    JsonObject& json = stream->getRoot();
+    app.rgbwwctrl.getTickStats().toJson(json);
+    json["idle"] = app.rgbwwctrl.isIdle();
+    sendApiResponse(response, stream);
+}
+
+void ApplicationWebserver::onSync(HttpRequest &request, HttpResponse &response) {
+    if (!authenticated(request, response)) {
+        return;
+    }
+
+    if (request.method != HTTP_POST && request.method != HTTP_GET) {
+        sendApiCode(response, API_CODES::API_BAD_REQUEST, "not POST or GET");
+        return;
+    }
+
+    // POST clears the samples, e.g. before changing the sync settings
+    if (request.method == HTTP_POST) {
+        app.rgbwwctrl.getSyncTelemetry().reset();
+        sendApiCode(response, API_CODES::API_SUCCESS);
+        return;
+    }
+
+    JsonObjectStream* stream = new JsonObjectStream();
+    JsonObject& json = stream->getRoot();
+    app.rgbwwctrl.getSyncTelemetry().toJson(json);
+    json["controller"] = app.cfg.sync.clock_slave_controller;
+    json["udp"] = app.syncudp.hasClock();
+    sendApiResponse(response, stream);
+}
+
 void ApplicationWebserver::generate204(HttpRequest &request, HttpResponse &response) {
     response.setHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     response.setHeader("Pragma", "no-cache");
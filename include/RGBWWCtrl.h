@@ -51,10 +51,19 @@
 #include <SmingCore/SmingCore.h>
 #include <otaupdate.h>
 #include <config.h>
+#include <tickstats.h>
+#include <synctelemetry.h>
+#include <tickscheduler.h>
+#include <colorsync.h>
+#include <animationprogram.h>
+#include <fadeengine.h>
+#include <colorstorage.h>
+#include <rtcstate.h>
 #include <ledctrl.h>
 #include <networking.h>
 #include <webserver.h>
 #include <mqtt.h>
+#include <syncudp.h>
 #include <eventserver.h>
 #include <jsonprocessor.h>
 #include <application.h>
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * Named animation program stored on SPIFFS
+ *
+ * Programs are uploaded as JSON (see JsonProcessor::onAnimation) and compiled
+ * into a list of fixed size binary steps, so playing them needs no parsing.
+ * File layout (little endian): ['A']['P'][version:1][number of steps:1] followed
+ * by the steps, _stepSize bytes each:
+ *   [op:1][flags:1][channel mask:1][reserved:1][time ms:4][values:8]
+ * Values are h, s, v, ct as uint16 (hsv) or r, g, b, ww, cw packed as 5x10 bit
+ * (raw). Loop steps store the target step and the repeat count (0 = forever)
+ * in the first two values.
+ */
+class AnimationProgram {
+public:
+    enum Op {
+        OpSolid = 1,
+        OpFade = 2,
+        OpBlink = 3,
+        OpLoop = 4,
+    };
+
+    enum Flags {
+        FlagRaw = 0x01,
+        FlagReverse = 0x02,
+    };
+
+    struct Step {
+        uint8_t op = OpSolid;
+        uint8_t flags = 0;
+        uint8_t mask = 0;
+        uint32_t time = 0;
+        uint16_t vals[5] = { 0 };
+    };
+
+    static const int _maxSteps = 64;
+    static const unsigned int _maxNameLen = 24;
+
+    void clear();
+    bool addStep(const Step& step);
+    int getNumSteps() const { return _numSteps; }
+    bool getStep(int idx, Step& step) const;
+
+    bool save(const String& name) const;
+    bool load(const String& name);
+
+    static void remove(const String& name);
+    static bool isValidName(const String& name);
+    static void list(Vector<String>& names);
+
+private:
+    static String getFileName(const String& name);
+
+    static const uint8_t _version = 1;
+    static const int _headerSize = 4;
+    static const int _stepSize = 16;
+
+    uint8_t _data[_maxSteps * _stepSize];
+    int _numSteps = 0;
+};
+
+
+/**
+ * Plays an AnimationProgram through the animation queue of the controller
+ *
+ * Only a few steps are queued ahead. Each queued step gets an internal name
+ * (_stepNamePrefix + sequence number); when the controller reports it as
+ * finished the next step is queued, following loop steps.
+ */
+class AnimationPlayer {
+public:
+    bool play(const String& name, String& error, int firstStep = 0);
+    void stop();
+    bool isPlaying() const { return _playing; }
+    const String& getName() const { return _name; }
+
+    // step currently running (approximately, loops are not tracked)
+    int getCurrentStep() const;
+
+    // returns true if name belongs to a step of the player
+    bool onAnimationFinished(const String& name);
+    void process();
+
+    static const char _stepNamePrefix = '~';
+
+private:
+    bool queueNext(bool first);
+    bool queueStep(const AnimationProgram::Step& step, QueuePolicy queue, const String& name);
+
+    static const uint32_t _queueAhead = 2;
+
+    AnimationProgram _program;
+    String _name;
+    bool _playing = false;
+    int _pc = 0;
+    bool _ended = false;
+    uint16_t _loopCounters[AnimationProgram::_maxSteps];
+
+    uint32_t _seqQueued = 0;
+    // reused for the step names, so queueing a step does not allocate
+    String _stepName;
+    uint32_t _seqFinished = 0;
+};
@@ -37,6 +37,7 @@ public:
     void reset();
     void restart();
     bool delayedCMD(String cmd, int delay);
+    void applyConfig(uint32_t sections);
 
     void mountfs(int slot);
     void umountfs();
@@ -49,6 +50,7 @@ public:
     void switchRom();
 
     void onCommandRelay(const String& method, const JsonObject& json);
+    void onCommandRelay(const String& method, const String& paramsJson);
     void onWifiConnected(const String& ssid);
 
     uint32_t getUptime();
@@ -62,10 +64,12 @@ public:
     ApplicationSettings cfg;
     EventServer eventserver;
     AppMqttClient mqttclient;
+    SyncUdp syncudp;
     JsonProcessor jsonproc;
 
 private:
     void loadbootinfo();
+    void applyNetworkConfig();
 
     Timer _systimer;
     int _bootmode = 0;
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Little endian writer for small fixed-layout binary frames
+ *
+ * Writes into a caller provided buffer and flags an overflow instead of
+ * writing past its end.
+ */
+class BinaryFrameWriter {
+public:
+    BinaryFrameWriter(uint8_t* pBuf, size_t size) : _pBuf(pBuf), _size(size) {}
+
+    void put8(uint8_t val) {
+        if (_pos >= _size) {
+            _overflow = true;
+            return;
+        }
+        _pBuf[_pos++] = val;
+    }
+
+    void put16(uint16_t val) {
+        put8(val & 0xff);
+        put8(val >> 8);
+    }
+
+    void put32(uint32_t val) {
+        put16(val & 0xffff);
+        put16(val >> 16);
+    }
+
+    void putBytes(const char* pData, size_t len) {
+        for(size_t i=0; i < len; ++i)
+            put8(pData[i]);
+    }
+
+    // packs five 10 bit channel values into 7 bytes
+    void putPacked10(uint16_t c0, uint16_t c1, uint16_t c2, uint16_t c3, uint16_t c4) {
+        const uint16_t vals[5] = { c0, c1, c2, c3, c4 };
+        uint32_t acc = 0;
+        int bits = 0;
+        for(int i=0; i < 5; ++i) {
+            acc |= static_cast<uint32_t>(vals[i] & 0x3ff) << bits;
+            bits += 10;
+            while (bits >= 8) {
+                put8(acc & 0xff);
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        put8(acc & 0xff);
+    }
+
+    // overwrite a single byte that has already been written (e.g. a length field)
+    void set8(size_t pos, uint8_t val) {
+        if (pos < _pos)
+            _pBuf[pos] = val;
+    }
+
+    const uint8_t* getData() const { return _pBuf; }
+    size_t getLength() const { return _pos; }
+    bool isValid() const { return !_overflow; }
+
+private:
+    uint8_t* _pBuf;
+    size_t _size;
+    size_t _pos = 0;
+    bool _overflow = false;
+};
+
+
+/**
+ * Counterpart of BinaryFrameWriter
+ */
+class BinaryFrameReader {
+public:
+    BinaryFrameReader(const uint8_t* pBuf, size_t len) : _pBuf(pBuf), _len(len) {}
+
+    uint8_t get8() {
+        if (_pos >= _len) {
+            _overflow = true;
+            return 0;
+        }
+        return _pBuf[_pos++];
+    }
+
+    uint16_t get16() {
+        uint16_t val = get8();
+        return val | (static_cast<uint16_t>(get8()) << 8);
+    }
+
+    uint32_t get32() {
+        uint32_t val = get16();
+        return val | (static_cast<uint32_t>(get16()) << 16);
+    }
+
+    void getPacked10(uint16_t vals[5]) {
+        uint32_t acc = 0;
+        int bits = 0;
+        for(int i=0; i < 5; ++i) {
+            while (bits < 10) {
+                acc |= static_cast<uint32_t>(get8()) << bits;
+                bits += 8;
+            }
+            vals[i] = acc & 0x3ff;
+            acc >>= 10;
+            bits -= 10;
+        }
+    }
+
+    size_t getRemaining() const { return _pos < _len ? _len - _pos : 0; }
+    const uint8_t* getCurrent() const { return _pBuf + _pos; }
+    bool isValid() const { return !_overflow; }
+
+private:
+    const uint8_t* _pBuf;
+    size_t _len;
+    size_t _pos = 0;
+    bool _overflow = false;
+};
+
+
+/**
+ * Hex text of binary frames for transports that are not binary safe
+ *
+ * The String based MQTT API of Sming sizes payloads with strlen(), so a
+ * binary frame would be cut at its first 0 byte.
+ */
+class BinaryFrameHex {
+public:
+    // writes 2 * len chars and a terminating 0 to pText
+    static void encode(const uint8_t* pData, size_t len, char* pText) {
+        static const char digits[] = "0123456789abcdef";
+        for(size_t i=0; i < len; ++i) {
+            *pText++ = digits[pData[i] >> 4];
+            *pText++ = digits[pData[i] & 0x0f];
+        }
+        *pText = 0;
+    }
+
+    // returns the number of bytes, 0 if the text is no hex or does not fit
+    static size_t decode(const char* pText, size_t textLen, uint8_t* pBuf, size_t size) {
+        if (textLen % 2 != 0 || textLen / 2 > size)
+            return 0;
+
+        for(size_t i=0; i < textLen / 2; ++i) {
+            const int hi = getDigit(pText[2 * i]);
+            const int lo = getDigit(pText[2 * i + 1]);
+            if (hi < 0 || lo < 0)
+                return 0;
+            pBuf[i] = (hi << 4) | lo;
+        }
+        return textLen / 2;
+    }
+
+private:
+    static int getDigit(char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+};
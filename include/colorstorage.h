@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// color file of older versions, read once for migration; still used if the
+// flash sectors are not available (see ColorStorage::checkArea())
+#define APP_COLOR_FILE ".color"
+
+
+/**
+ * Persistent storage of the last color
+ *
+ * Colors are appended as small binary records to a ring of flash sectors
+ * outside of SPIFFS. Each save writes one record; a sector is only erased when
+ * the ring wraps around to it, i.e. every _numSectors * _recordsPerSector
+ * saves. The latest record is found by its sequence number when loading.
+ */
+class ColorStorage {
+public:
+    HSVCT current;
+
+    void load(bool print = false);
+    void save(bool print = false);
+    bool exist();
+
+private:
+    struct Record {
+        uint8_t magic;
+        uint8_t version;
+        uint16_t checksum;
+        uint32_t seq;
+        uint16_t h;
+        uint16_t s;
+        uint16_t v;
+        uint16_t ct;
+    };
+
+    // free space between SPIFFS 0 (RBOOT_SPIFFS_0 + SPIFF_SIZE, 0x1C0000 with
+    // the default layout) and ROM 1 (0x202000), see checkArea()
+    static const uint32_t _firstSector = 0x1FC;
+    static const uint32_t _numSectors = 2;
+    static const uint32_t _recordsPerSector = SPI_FLASH_SEC_SIZE / sizeof(Record);
+    static const uint32_t _numRecords = _numSectors * _recordsPerSector;
+
+    static const uint8_t _magic = 0xC5;
+    static const uint8_t _version = 1;
+
+    static uint32_t getAddress(uint32_t slot);
+    static uint16_t calcChecksum(const Record& record);
+    static bool isErased(const Record& record);
+    static bool checkArea();
+
+    void scan();
+    bool migrate();
+    bool saveRecord();
+    bool loadFile();
+    void saveFile();
+
+    bool _scanned = false;
+    bool _usable = false;
+    bool _hasRecord = false;
+    uint32_t _seq = 0;
+    uint32_t _nextSlot = 0;
+    HSVCT _saved;
+};
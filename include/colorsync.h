@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <RGBWWLed/RGBWWLed.h>
+
+
+/**
+ * Jitter buffer for colors received from a color sync master
+ *
+ * Each sample is stamped with the master step counter. Samples are played back
+ * a fixed number of steps (the buffer delay) behind the newest master step
+ * seen, mapped onto the local step counter, and the output is interpolated
+ * linearly between the two samples surrounding the playback position. Network
+ * jitter smaller than the delay therefore does not show up as stepping and the
+ * master can publish less often.
+ *
+ * The master only publishes changes, so a sample after a hold must not be
+ * interpolated from the one before the hold. The publish interval is taken
+ * from the smallest gap between samples; after a longer gap the previous
+ * value is held until one interval before the new sample, like a master
+ * publishing the held value right before the change would do.
+ */
+class ColorSyncBuffer {
+public:
+    enum class Mode {
+        Hsv,
+        Raw,
+    };
+
+    void reset();
+    void setDelay(uint32_t steps) { _delaySteps = steps; }
+
+    void onSample(uint32_t stepsLocal, uint32_t stepsMaster, Mode mode, const int vals[5]);
+
+    // returns true if vals contains a new value to apply for the current step
+    bool process(uint32_t stepsLocal, Mode& mode, int vals[5]);
+
+private:
+    struct Sample {
+        uint32_t steps;
+        int vals[5];
+    };
+
+    static const int _maxSamples = 4;
+    // reset if the master jumps by more than this (e.g. after a reboot)
+    static const int32_t _maxGapSteps = 5 * RGBWW_UPDATEFREQUENCY;
+
+    void addSample(uint32_t stepsMaster, const int vals[5]);
+
+    Sample _samples[_maxSamples];
+    int _numSamples = 0;
+    // publish interval of the master in steps, 0 if unknown
+    uint32_t _intervalSteps = 0;
+    Mode _mode = Mode::Hsv;
+
+    // local step counter minus master step counter
+    int32_t _offset = 0;
+    uint32_t _delaySteps = 5;
+
+    int _lastVals[5];
+    bool _hasLast = false;
+};
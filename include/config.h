@@ -23,10 +23,15 @@
 
 #include <SmingCore/SmingCore.h>
 #include <RGBWWCtrl.h>
+#include "binaryframe.h"
 
+// JSON settings of older versions, imported once
 #define APP_SETTINGS_FILE ".cfg"
 #define APP_SETTINGS_VERSION 1
 
+// prefix of the binary settings sections
+#define APP_SETTINGS_SECTION_PREFIX ".cfg_"
+
 struct ApplicationSettings {
     struct network {
         struct connection {
@@ -44,6 +49,7 @@ struct ApplicationSettings {
             String username;
             String password;
             String topic_base = "home/";
+            int publish_interval_ms = 100;
         };
 
         struct ap {
@@ -63,6 +69,8 @@ struct ApplicationSettings {
 
         bool clock_slave_enabled = false;
         String clock_slave_topic= "home/led1/clock";
+        // "catchup" or "pi", see stepsync.h
+        String clock_slave_controller = "catchup";
 
         bool cmd_master_enabled = false;
         bool cmd_slave_enabled = false;
@@ -70,8 +78,15 @@ struct ApplicationSettings {
 
         bool color_master_enabled = false;
         int color_master_interval_ms = 0;
+        bool color_master_binary = false;
         bool color_slave_enabled = false;
         String color_slave_topic = "home/led1/color";
+        int color_slave_buffer_steps = 5;
+
+        // clock and color via multicast in addition to MQTT, see syncudp.h
+        bool udp_enabled = false;
+        String udp_group = "239.255.42.42";
+        int udp_port = 9092;
     };
 
     struct events {
@@ -126,130 +141,127 @@ struct ApplicationSettings {
     sync sync;
     events events;
 
-    void load(bool print = false) {
-        DynamicJsonBuffer jsonBuffer;
-        if (exist()) {
-            int size = fileGetSize(APP_SETTINGS_FILE);
-            char* jsonString = new char[size + 1];
-            fileGetContent(APP_SETTINGS_FILE, jsonString, size + 1);
-            JsonObject& root = jsonBuffer.parseObject(jsonString);
-
-            // connection
-            network.connection.mdnshostname = root["network"]["connection"]["hostname"].asString();
-            network.connection.dhcp = root["network"]["connection"]["dhcp"];
-            network.connection.ip = root["network"]["connection"]["ip"].asString();
-            network.connection.netmask = root["network"]["connection"]["netmask"].asString();
-            network.connection.gateway = root["network"]["connection"]["gateway"].asString();
-
-            // accesspoint
-            network.ap.secured = root["network"]["ap"]["secured"];
-            network.ap.ssid = root["network"]["ap"]["ssid"].asString();
-            network.ap.password = root["network"]["ap"]["password"].asString();
-
-            // mqtt
-            if (root["network"]["mqtt"].success()) {
-                if (root["network"]["mqtt"]["enabled"].success())
-                    network.mqtt.enabled = root["network"]["mqtt"]["enabled"];
-                if (root["network"]["mqtt"]["server"].success())
-                    network.mqtt.server = root["network"]["mqtt"]["server"].asString();
-                if (root["network"]["mqtt"]["port"].success())
-                    network.mqtt.port = root["network"]["mqtt"]["port"];
-                if (root["network"]["mqtt"]["username"].success())
-                    network.mqtt.username = root["network"]["mqtt"]["username"].asString();
-                if (root["network"]["mqtt"]["password"].success())
-                    network.mqtt.password = root["network"]["mqtt"]["password"].asString();
-                if (root["network"]["mqtt"]["topic_base"].success())
-                    network.mqtt.topic_base = root["network"]["mqtt"]["topic_base"].asString();
-            }
-
-            // color
-            color.outputmode = root["color"]["outputmode"];
-            if (root["color"]["startup_color"].success())
-                color.startup_color = root["color"]["startup_color"].asString();
-
-            // hsv
-            color.hsv.model = root["color"]["hsv"]["model"];
-            color.hsv.red = root["color"]["hsv"]["red"];
-            color.hsv.yellow = root["color"]["hsv"]["yellow"];
-            color.hsv.green = root["color"]["hsv"]["green"];
-            color.hsv.cyan = root["color"]["hsv"]["cyan"];
-            color.hsv.blue = root["color"]["hsv"]["blue"];
-            color.hsv.magenta = root["color"]["hsv"]["magenta"];
-
-            // brightness
-            color.brightness.red = root["color"]["brightness"]["red"];
-            color.brightness.green = root["color"]["brightness"]["green"];
-            color.brightness.blue = root["color"]["brightness"]["blue"];
-            color.brightness.ww = root["color"]["brightness"]["ww"];
-            color.brightness.cw = root["color"]["brightness"]["cw"];
-
-            // general
-            if (root["general"].success()) {
-                if (root["general"]["api_password"].success())
-                    general.api_password = root["general"]["api_password"].asString();
-                if (root["general"]["api_secured"].success())
-                    general.api_secured = root["general"]["api_secured"];
-                if (root["general"]["otaurl"].success())
-                    general.otaurl = root["general"]["otaurl"].asString();
-                if (root["general"]["device_name"].success())
-                    general.device_name = root["general"]["device_name"].asString();
-                if (root["general"]["pin_config"].success())
-                    general.pin_config = root["general"]["pin_config"].asString();
-            }
-
-            // sync
-            if (root["sync"].success()) {
-                if (root["sync"]["clock_master_enabled"].success())
-                    sync.clock_master_enabled = root["sync"]["clock_master_enabled"];
-                if (root["sync"]["clock_master_interval"].success())
-                    sync.clock_master_interval = root["sync"]["clock_master_interval"];
-                if (root["sync"]["clock_slave_topic"].success())
-                    sync.clock_slave_topic = root["sync"]["clock_slave_topic"].asString();
-                if (root["sync"]["clock_slave_enabled"].success())
-                    sync.clock_slave_enabled = root["sync"]["clock_slave_enabled"];
-
-                if (root["sync"]["cmd_master_enabled"].success())
-                    sync.cmd_master_enabled = root["sync"]["cmd_master_enabled"];
-                if (root["sync"]["cmd_slave_enabled"].success())
-                    sync.cmd_slave_enabled = root["sync"]["cmd_slave_enabled"];
-                if (root["sync"]["cmd_slave_topic"].success())
-                    sync.cmd_slave_topic = root["sync"]["cmd_slave_topic"].asString();
-
-                if (root["sync"]["color_master_enabled"].success())
-                    sync.color_master_enabled = root["sync"]["color_master_enabled"];
-                if (root["sync"]["color_master_interval_ms"].success())
-                    sync.color_master_interval_ms = root["sync"]["color_master_interval_ms"];
-                if (root["sync"]["color_slave_enabled"].success())
-                    sync.color_slave_enabled = root["sync"]["color_slave_enabled"];
-                if (root["sync"]["color_slave_topic"].success())
-                    sync.color_slave_topic = root["sync"]["color_slave_topic"].asString();
-            }
-
-
-            // events
-            if (root["events"].success()) {
-                if (root["events"]["server_enabled"].success())
-                    events.server_enabled = root["events"]["server_enabled"];
-                if (root["events"]["color_interval_ms"].success())
-                    events.color_interval_ms = root["events"]["color_interval_ms"];
-                if (root["events"]["transfin_interval_ms"].success())
-                    events.transfin_interval_ms = root["events"]["transfin_interval_ms"];
-            }
-
-            if (print) {
-                root.prettyPrintTo(Serial);
-            }
-
-            delete[] jsonString;
+    // settings of the JSON format (APP_SETTINGS_FILE)
+    void importJson(JsonObject& root) {
+        // connection
+        network.connection.mdnshostname = root["network"]["connection"]["hostname"].asString();
+        network.connection.dhcp = root["network"]["connection"]["dhcp"];
+        network.connection.ip = root["network"]["connection"]["ip"].asString();
+        network.connection.netmask = root["network"]["connection"]["netmask"].asString();
+        network.connection.gateway = root["network"]["connection"]["gateway"].asString();
+
+        // accesspoint
+        network.ap.secured = root["network"]["ap"]["secured"];
+        network.ap.ssid = root["network"]["ap"]["ssid"].asString();
+        network.ap.password = root["network"]["ap"]["password"].asString();
+
+        // mqtt
+        if (root["network"]["mqtt"].success()) {
+            if (root["network"]["mqtt"]["enabled"].success())
+                network.mqtt.enabled = root["network"]["mqtt"]["enabled"];
+            if (root["network"]["mqtt"]["server"].success())
+                network.mqtt.server = root["network"]["mqtt"]["server"].asString();
+            if (root["network"]["mqtt"]["port"].success())
+                network.mqtt.port = root["network"]["mqtt"]["port"];
+            if (root["network"]["mqtt"]["username"].success())
+                network.mqtt.username = root["network"]["mqtt"]["username"].asString();
+            if (root["network"]["mqtt"]["password"].success())
+                network.mqtt.password = root["network"]["mqtt"]["password"].asString();
+            if (root["network"]["mqtt"]["topic_base"].success())
+                network.mqtt.topic_base = root["network"]["mqtt"]["topic_base"].asString();
+            if (root["network"]["mqtt"]["publish_interval_ms"].success())
+                network.mqtt.publish_interval_ms = root["network"]["mqtt"]["publish_interval_ms"];
         }
 
-        sanitizeValues();
-    }
+        // color
+        color.outputmode = root["color"]["outputmode"];
+        if (root["color"]["startup_color"].success())
+            color.startup_color = root["color"]["startup_color"].asString();
+
+        // hsv
+        color.hsv.model = root["color"]["hsv"]["model"];
+        color.hsv.red = root["color"]["hsv"]["red"];
+        color.hsv.yellow = root["color"]["hsv"]["yellow"];
+        color.hsv.green = root["color"]["hsv"]["green"];
+        color.hsv.cyan = root["color"]["hsv"]["cyan"];
+        color.hsv.blue = root["color"]["hsv"]["blue"];
+        color.hsv.magenta = root["color"]["hsv"]["magenta"];
+
+        // brightness
+        color.brightness.red = root["color"]["brightness"]["red"];
+        color.brightness.green = root["color"]["brightness"]["green"];
+        color.brightness.blue = root["color"]["brightness"]["blue"];
+        color.brightness.ww = root["color"]["brightness"]["ww"];
+        color.brightness.cw = root["color"]["brightness"]["cw"];
+
+        // general
+        if (root["general"].success()) {
+            if (root["general"]["api_password"].success())
+                general.api_password = root["general"]["api_password"].asString();
+            if (root["general"]["api_secured"].success())
+                general.api_secured = root["general"]["api_secured"];
+            if (root["general"]["otaurl"].success())
+                general.otaurl = root["general"]["otaurl"].asString();
+            if (root["general"]["device_name"].success())
+                general.device_name = root["general"]["device_name"].asString();
+            if (root["general"]["pin_config"].success())
+                general.pin_config = root["general"]["pin_config"].asString();
+        }
+
+        // sync
+        if (root["sync"].success()) {
+            if (root["sync"]["clock_master_enabled"].success())
+                sync.clock_master_enabled = root["sync"]["clock_master_enabled"];
+            if (root["sync"]["clock_master_interval"].success())
+                sync.clock_master_interval = root["sync"]["clock_master_interval"];
+            if (root["sync"]["clock_slave_topic"].success())
+                sync.clock_slave_topic = root["sync"]["clock_slave_topic"].asString();
+            if (root["sync"]["clock_slave_enabled"].success())
+                sync.clock_slave_enabled = root["sync"]["clock_slave_enabled"];
+            if (root["sync"]["clock_slave_controller"].success())
+                sync.clock_slave_controller = root["sync"]["clock_slave_controller"].asString();
+
+            if (root["sync"]["cmd_master_enabled"].success())
+                sync.cmd_master_enabled = root["sync"]["cmd_master_enabled"];
+            if (root["sync"]["cmd_slave_enabled"].success())
+                sync.cmd_slave_enabled = root["sync"]["cmd_slave_enabled"];
+            if (root["sync"]["cmd_slave_topic"].success())
+                sync.cmd_slave_topic = root["sync"]["cmd_slave_topic"].asString();
+
+            if (root["sync"]["color_master_enabled"].success())
+                sync.color_master_enabled = root["sync"]["color_master_enabled"];
+            if (root["sync"]["color_master_interval_ms"].success())
+                sync.color_master_interval_ms = root["sync"]["color_master_interval_ms"];
+            if (root["sync"]["color_master_binary"].success())
+                sync.color_master_binary = root["sync"]["color_master_binary"];
+            if (root["sync"]["color_slave_enabled"].success())
+                sync.color_slave_enabled = root["sync"]["color_slave_enabled"];
+            if (root["sync"]["color_slave_topic"].success())
+                sync.color_slave_topic = root["sync"]["color_slave_topic"].asString();
+            if (root["sync"]["color_slave_buffer_steps"].success())
+                sync.color_slave_buffer_steps = root["sync"]["color_slave_buffer_steps"];
+
+            if (root["sync"]["udp_enabled"].success())
+                sync.udp_enabled = root["sync"]["udp_enabled"];
+            if (root["sync"]["udp_group"].success())
+                sync.udp_group = root["sync"]["udp_group"].asString();
+            if (root["sync"]["udp_port"].success())
+                sync.udp_port = root["sync"]["udp_port"];
+        }
 
-    void save(bool print = false) {
-        DynamicJsonBuffer jsonBuffer;
-        JsonObject& root = jsonBuffer.createObject();
 
+        // events
+        if (root["events"].success()) {
+            if (root["events"]["server_enabled"].success())
+                events.server_enabled = root["events"]["server_enabled"];
+            if (root["events"]["color_interval_ms"].success())
+                events.color_interval_ms = root["events"]["color_interval_ms"];
+            if (root["events"]["transfin_interval_ms"].success())
+                events.transfin_interval_ms = root["events"]["transfin_interval_ms"];
+        }
+    }
+
+    void exportJson(JsonObject& root) {
         JsonObject& net = root.createNestedObject("network");
         JsonObject& con = net.createNestedObject("connection");
         con["dhcp"] = network.connection.dhcp;
@@ -270,6 +282,7 @@ struct ApplicationSettings {
         jmqtt["username"] = network.mqtt.username.c_str();
         jmqtt["password"] = network.mqtt.password.c_str();
         jmqtt["topic_base"] = network.mqtt.topic_base.c_str();
+        jmqtt["publish_interval_ms"] = network.mqtt.publish_interval_ms;
 
         JsonObject& c = root.createNestedObject("color");
         c["outputmode"] = color.outputmode;
@@ -295,12 +308,12 @@ struct ApplicationSettings {
         t["ww"] = color.colortemp.ww;
         t["cw"] = color.colortemp.cw;
 
-        JsonObject& s = jsonBuffer.createObject();
-        root["sync"] = s;
+        JsonObject& s = root.createNestedObject("sync");
         s["clock_master_enabled"] = sync.clock_master_enabled;
         s["clock_master_interval"] = sync.clock_master_interval;
         s["clock_slave_enabled"] = sync.clock_slave_enabled;
         s["clock_slave_topic"] = sync.clock_slave_topic.c_str();
+        s["clock_slave_controller"] = sync.clock_slave_controller.c_str();
 
         s["cmd_master_enabled"] = sync.cmd_master_enabled;
         s["cmd_slave_enabled"] = sync.cmd_slave_enabled;
@@ -308,43 +321,71 @@ struct ApplicationSettings {
 
         s["color_master_enabled"] = sync.color_master_enabled;
         s["color_master_interval_ms"] = sync.color_master_interval_ms;
+        s["color_master_binary"] = sync.color_master_binary;
         s["color_slave_enabled"] = sync.color_slave_enabled;
         s["color_slave_topic"] = sync.color_slave_topic.c_str();
+        s["color_slave_buffer_steps"] = sync.color_slave_buffer_steps;
+
+        s["udp_enabled"] = sync.udp_enabled;
+        s["udp_group"] = sync.udp_group.c_str();
+        s["udp_port"] = sync.udp_port;
 
-        JsonObject& e = jsonBuffer.createObject();
-        root["events"] = e;
+        JsonObject& e = root.createNestedObject("events");
         e["color_interval_ms"] = events.color_interval_ms;
         e["server_enabled"] = events.server_enabled;
         e["transfin_interval_ms"] = events.transfin_interval_ms;
 
-        JsonObject& g = jsonBuffer.createObject();
-        root["general"] = g;
+        JsonObject& g = root.createNestedObject("general");
         g["api_secured"] = general.api_secured;
         g["api_password"] = general.api_password;
         g["otaurl"] = general.otaurl;
         g["device_name"] = general.device_name.c_str();
         g["pin_config"] = general.pin_config.c_str();
         g["settings_ver"] = APP_SETTINGS_VERSION;
-
-        String rootString;
-        if (print) {
-            root.prettyPrintTo(Serial);
-        }
-        root.printTo(rootString);
-        fileSetContent(APP_SETTINGS_FILE, rootString);
     }
 
-    bool exist() {
-        return fileExist(APP_SETTINGS_FILE);
-    }
+    // binary settings, see app/config.cpp
+    void load(bool print = false);
+    // only changed sections are written, force writes all of them (e.g. to
+    // the freshly flashed filesystem of an OTA update)
+    void save(bool print = false, bool force = false);
+    bool exist();
+    void reset();
+
+    enum Section {
+        SectionNetwork = 0,
+        SectionMqtt,
+        SectionSync,
+        SectionColor,
+        SectionEvents,
+        SectionGeneral,
+        SectionCount,
+    };
 
-    void reset() {
-        if (exist()) {
-            fileDelete(APP_SETTINGS_FILE);
-        }
-    }
+    // bitmask (1 << Section) of the sections that differ from the stored ones
+    uint32_t getChangedSections();
 
     void sanitizeValues() {
         sync.clock_master_interval = max(sync.clock_master_interval, 1);
+        network.mqtt.publish_interval_ms = max(network.mqtt.publish_interval_ms, 20);
+        sync.color_slave_buffer_steps = max(sync.color_slave_buffer_steps, 0);
     }
+
+private:
+    static const uint8_t _sectionVersion = 1;
+    static const size_t _sectionHeaderSize = 8;
+    static const size_t _maxSectionSize = 512;
+
+    static String getSectionFile(Section section);
+    static uint16_t calcCrc(const uint8_t* pData, size_t len);
+
+    void writeSection(Section section, BinaryFrameWriter& frame);
+    void readSection(Section section, BinaryFrameReader& frame);
+    bool serializeSection(Section section, BinaryFrameWriter& frame, uint16_t& crc);
+    bool loadSection(Section section);
+    bool saveSection(Section section, bool force);
+
+    // crc of the stored sections, unchanged sections are not written again
+    uint16_t _sectionCrc[SectionCount] = { 0 };
+    bool _sectionStored[SectionCount] = { false };
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Reference counted, serialized event shared by all event server clients
+ *
+ * An event is serialized once into a payload which is then queued to every
+ * client without copying it. Payloads up to _poolSlotSize bytes come from a
+ * fixed pool so frequent color events do not fragment the heap; larger ones
+ * fall back to the heap.
+ */
+class EventPayload {
+public:
+    static EventPayload* create(size_t capacity, bool droppable);
+
+    void addRef() { ++_refCount; }
+    void release();
+
+    char* getBuffer() { return _pData; }
+    size_t getCapacity() const { return _capacity; }
+
+    void setLength(size_t len) { _len = len; }
+    const char* getData() const { return _pData; }
+    size_t getLength() const { return _len; }
+
+    // droppable payloads may be discarded for slow clients (e.g. color events)
+    bool isDroppable() const { return _droppable; }
+
+    static const size_t _poolSlotSize = 224;
+
+private:
+    static const int _poolSize = 8;
+    static EventPayload _pool[_poolSize];
+    static char _poolBuffers[_poolSize][_poolSlotSize];
+
+    char* _pData = nullptr;
+    uint16_t _capacity = 0;
+    uint16_t _len = 0;
+    uint16_t _refCount = 0;
+    bool _droppable = true;
+    bool _pooled = false;
+};
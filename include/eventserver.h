@@ -3,30 +3,178 @@
 #include <Wiring/WVector.h>
 
 #include "jsonrpcmessage.h"
+#include "binaryframe.h"
+#include "eventpayload.h"
+
+/**
+ * Connection to a single event server client
+ *
+ * Clients receive JSON-RPC notifications by default. After connecting they can
+ * switch to the compact binary format by sending
+ * {"jsonrpc":"2.0","method":"hello","params":{"format":"binary"}}
+ *
+ * Binary frames: [type:1][payload length:1][payload], all values little endian
+ *   0x01 color_event (raw):  raw r,g,b,ww,cw packed as 5x10 bit (7 bytes)
+ *   0x02 color_event (hsv):  packed raw (7 bytes), h, s, v, ct (4x uint16)
+ *   0x03 transition_finished: requeued (uint8), name (remaining bytes)
+ *   0x04 clock_slave_status: offset (int32), current_interval (uint32)
+ *   0x05 keep_alive: no payload
+ *
+ * By default a client receives all events. It can restrict them by sending
+ * {"jsonrpc":"2.0","method":"subscribe","params":{"events":{"color_event":500,"transition_finished":0}}}
+ * Only the listed events are sent afterwards, each at most once per given
+ * interval (ms, 0 = no limit). A color event skipped because of the interval is
+ * delivered once the interval has passed, so the client always ends up with the
+ * latest color. Skipped transition_finished events are kept per client (the
+ * same name only once) and delivered together once the interval has passed.
+ * Clients not subscribing to keep_alive should send something within the
+ * connection timeout.
+ *
+ * JSON clients can request the sync telemetry of a slave (see GET /sync) with
+ * {"jsonrpc":"2.0","method":"sync","params":{"samples":8},"id":1}
+ * The reply only goes to the requesting client, as JSON-RPC result with the id
+ * of the request. "samples" (optional) limits the rows of the sample ring.
+ * Binary clients and requests without an id get no reply.
+ *
+ * Outgoing events are queued as shared payloads and written to the TCP
+ * connection only when its send buffer has room, so a slow client never blocks
+ * the caller. If too many droppable events (color events, status, keep alive)
+ * pile up the oldest unsent ones are dropped; transition_finished is never
+ * dropped.
+ */
+class EventServerClient : public TcpClient {
+public:
+	enum class Format {
+		Json,
+		Binary,
+	};
+
+	enum EventType {
+		EventColor,
+		EventTransitionFinished,
+		EventClockSlaveStatus,
+		EventKeepAlive,
+		EventTypeCount,
+	};
+
+	EventServerClient(tcp_pcb* clientTcp, TcpClientDataDelegate clientReceive, TcpClientCompleteDelegate onCompleted);
+	virtual ~EventServerClient();
+
+	Format getFormat() const { return _format; }
+	void setFormat(Format format) { _format = format; }
+
+	void unsubscribeAll();
+	void subscribe(EventType type, uint32_t minIntervalMs);
+	bool select(EventType type, uint32_t now, bool changed);
+	bool isSelected() const { return _selected; }
+	bool isSubscribed(EventType type) const { return _subscriptions[type].enabled; }
+	uint32_t getMinInterval(EventType type) const { return _subscriptions[type].minIntervalMs; }
+	static bool getEventType(const String& name, EventType& type);
+
+	bool feed(char c);
+	const String& getRequest() const { return _rxBuf; }
+
+	// a client that overflowed its queue takes no more events and waits to be closed
+	void enqueue(EventPayload* pPayload);
+	bool isClosing() const { return _closing; }
+
+	// transition_finished events held back by the subscription interval, only
+	// used by clients with an interval
+	void deferTransition(const String& name, bool requeued);
+	HashMap<String, bool>& getPendingTransitions() { return _pendingTransitions; }
+	void pump();
+	uint32_t getNumDropped() const { return _numDropped; }
+
+protected:
+	virtual err_t onSent(uint16_t len) override;
+
+private:
+	struct QueueEntry {
+		EventPayload* pPayload;
+		uint16_t written;
+	};
+
+	struct Subscription {
+		bool enabled = true;
+		bool pending = false;
+		uint32_t minIntervalMs = 0;
+		uint32_t lastSentMs = 0;
+	};
+
+	bool dropOldestUnsent();
+	void removeEntry(int idx);
+
+	static const unsigned int _maxRequestLen = 512;
+	static const int _maxQueued = 16;
+	static const int _maxDroppable = 4;
+	static const unsigned int _maxPendingTransitions = 16;
+
+	QueueEntry _queue[_maxQueued];
+	int _numQueued = 0;
+	int _numDroppable = 0;
+	uint32_t _numDropped = 0;
+	bool _closing = false;
+
+	Subscription _subscriptions[EventTypeCount];
+	HashMap<String, bool> _pendingTransitions;
+	bool _selected = false;
+
+	Format _format = Format::Json;
+	String _rxBuf;
+	int _rxDepth = 0;
+	bool _rxInString = false;
+	bool _rxEscape = false;
+};
 
 class EventServer : public TcpServer{
 public:
 	virtual ~EventServer();
 	void start();
 	void stop();
+	bool isRunning() const { return _enabled; }
 
 	void publishCurrentState(const ChannelOutput& raw, const HSVCT* pColor = NULL);
 	void publishTransitionFinished(const String& name, bool requeued = false);
 	void publishKeepAlive();
 	void publishClockSlaveStatus(uint32_t offset, uint32_t interval);
 
+	enum FrameType {
+		FrameColorRaw = 0x01,
+		FrameColorHsv = 0x02,
+		FrameTransitionFinished = 0x03,
+		FrameClockSlaveStatus = 0x04,
+		FrameKeepAlive = 0x05,
+	};
+
 private:
+	virtual TcpConnection* createClient(tcp_pcb *clientTcp) override;
 	virtual void onClient(TcpClient *client) override;
+	virtual bool onClientReceive(TcpClient& client, char *data, int size) override;
 	virtual void onClientComplete(TcpClient& client, bool succesfull) override;
 
-	void sendToClients(JsonRpcMessage& rpcMsg);
+	void processRequest(EventServerClient& client, const String& request);
+
+	bool selectClients(EventServerClient::EventType type, bool changed = true);
+	bool hasClients(EventServerClient::Format format);
+	void sendToClients(JsonRpcMessage& rpcMsg, bool droppable);
+	void closePendingClients();
+	void sendPendingTransitions();
+	void sendPendingTransitionsTo(EventServerClient& client);
+	EventPayload* createTransitionFinished(EventServerClient::Format format, const String& name, bool requeued);
+	static EventPayload* createPayload(JsonObject& root, bool droppable);
+	void sendToClients(EventPayload* pPayload, EventServerClient::Format format);
+	void sendFrame(EventPayload* pPayload, BinaryFrameWriter& frame);
 
 	static const int _tcpPort = 9090;
 	static const int _connectionTimeout = 120;
 	static const int _keepAliveInterval = 60;
+	static const int _pendingCheckMs = 100;
 
     Timer _keepAliveTimer;
+	Timer _pendingTimer;
 	int _nextId = 1;
+	bool _enabled = false;
+	bool _listening = false;
 
 	ChannelOutput _lastRaw;
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * Fade engine of the application using fixed point integer math only
+ *
+ * Used for fades with an easing curve ("ease" in the color command), which
+ * the animation queue of the controller cannot do. Each step the fade
+ * position is advanced as a Q16 fraction (0..65536) without any division,
+ * mapped through the easing curve and applied to the channel deltas. The
+ * result only depends on the start values, the number of steps and the curve,
+ * so master and slaves produce identical values.
+ *
+ * Apart from smooth the curves are tables of _tableSize points that are
+ * interpolated linearly. Log fades brightness (v, or all raw channels) linearly
+ * in CIE lightness instead of luminance, so they look even to the eye.
+ */
+class FadeEngine {
+public:
+    enum class Ease {
+        Linear,
+        Smooth,
+        In,
+        Out,
+        InOut,
+        Cubic,
+        Log,
+    };
+
+    static const uint32_t _one = 1 << 16;
+
+    static bool parseEase(const char* name, Ease& ease);
+
+    // Q16 position in, Q16 eased position out
+    static uint32_t applyEase(Ease ease, uint32_t pos);
+
+    // hue (channel 0 in hsv mode) takes the shorter way if direction is 1
+    void start(bool raw, const int from[5], const int to[5], uint32_t steps, Ease ease, int direction, const String& name);
+
+    // continues a fade at step of steps, with from and delta of getFrom() and
+    // getDelta() (the signed hue delta already includes the direction)
+    void resume(bool raw, const int from[5], const int delta[5], uint32_t steps, uint32_t step, Ease ease, int direction, const String& name);
+
+    void stop() { _active = false; }
+    bool isActive() const { return _active; }
+    bool isRaw() const { return _raw; }
+    const String& getName() const { return _name; }
+    Ease getEase() const { return _ease; }
+    int getDirection() const { return _direction; }
+    uint32_t getRemainingSteps() const { return _steps - _step; }
+    uint32_t getSteps() const { return _steps; }
+    uint32_t getStep() const { return _step; }
+    void getFrom(int from[5]) const;
+    void getDelta(int delta[5]) const;
+    void getTarget(int to[5]) const;
+
+    // advances one step, returns true once the target is reached
+    bool process(int vals[5]);
+
+private:
+    static const int _tableSize = 33;
+    static const uint16_t _tableIn[_tableSize];
+    static const uint16_t _tableOut[_tableSize];
+    static const uint16_t _tableInOut[_tableSize];
+    static const uint16_t _tableCubic[_tableSize];
+
+    // luminance (0..65535) over lightness
+    static const uint16_t _tableLightness[_tableSize];
+
+    // lightness is Q15 so its deltas times a Q16 position fit into 32 bit
+    static const uint32_t _lightnessOne = 1 << 15;
+
+    static uint32_t interpolate(const uint16_t* pTable, uint32_t x, int segmentBits);
+    static uint32_t toLightness(int val, int maxVal);
+    static int fromLightness(uint32_t lightness, int maxVal);
+
+    bool _active = false;
+    bool _raw = false;
+    Ease _ease = Ease::Linear;
+    int _direction = 1;
+    String _name;
+
+    int _from[5];
+    int _delta[5];
+
+    // channels faded in lightness (Ease::Log)
+    uint8_t _lightnessMask = 0;
+    int32_t _fromLightness[5];
+    int32_t _deltaLightness[5];
+
+    uint32_t _steps = 0;
+    uint32_t _step = 0;
+
+    // position as _pos + _rem / _steps
+    uint32_t _pos = 0;
+    uint32_t _rem = 0;
+    uint32_t _posInc = 0;
+    uint32_t _remInc = 0;
+};
@@ -3,11 +3,20 @@
 #include <SmingCore/SmingCore.h>
 #include <RGBWWLed/RGBWWLedColor.h>
 
+#include "jsontokenizer.h"
+
 
 class JsonProcessor {
 public:
-    bool onColor(const String& json, String& msg, bool relay = true);
-    bool onColor(JsonObject& root, String& msg, bool relay = true);
+    /**
+     * Single color command or a batch {"cmds":[...]}
+     *
+     * A batch is validated completely before anything is queued and may hold at
+     * most RGBWW_ANIMATIONQSIZE commands. If pResults is given, the result of
+     * each batch command is added to it.
+     */
+    bool onColor(const String& json, String& msg, bool relay = true, JsonArray* pResults = nullptr);
+    bool onColor(const char* pJson, size_t len, String& msg, JsonArray* pResults = nullptr);
 
     bool onStop(const String& json, String& msg, bool relay = true);
     bool onStop(JsonObject& root, String& msg, bool relay = true);
@@ -27,6 +36,16 @@ public:
     bool onDirect(const String& json, String& msg, bool relay);
     bool onDirect(JsonObject& root, String& msg, bool relay);
 
+    /**
+     * Animation programs (see AnimationProgram)
+     *
+     * Upload:  {"name":"scene","steps":[{"hsv":{...},"t":1000,"cmd":"fade"},
+     *           {"cmd":"blink","t":500},{"cmd":"loop","to":0,"count":3}]}
+     *          (count 0 loops forever, only absolute values are allowed)
+     * Control: {"play":"scene"}, {"stop":true}, {"delete":"scene"}
+     */
+    bool onAnimation(const String& json, String& msg, bool relay = true);
+
     bool onJsonRpc(const String& json);
 
 private:
@@ -59,17 +78,35 @@ private:
         RampTimeOrSpeed ramp = 0;
         String name;
 
+        // easing curve, fades with a curve run in the FadeEngine
+        String ease;
+
         String cmd = "solid";
 
         RGBWWLed::ChannelList channels;
 
         QueuePolicy queue = QueuePolicy::Single;
 
+        // loop steps of animation programs
+        int loopTo = -1;
+        int loopCount = 0;
+
         int checkParams(String& errorMsg) const;
     };
 
     void parseRequestParams(JsonObject& root, RequestParameters& params);
+
+    bool parseRequestParams(JsonTokenizer& tok, RequestParameters& params);
+    bool parseRequestParam(JsonTokenizer& tok, JsonTokenizer::Token token, RequestParameters& params);
+    bool parseHsv(JsonTokenizer& tok, RequestHSVCT& hsv, RequestParameters& params, bool isFrom);
+    bool parseRaw(JsonTokenizer& tok, RequestChannelOutput& raw, RequestParameters& params, bool isFrom);
+    bool parseChannels(JsonTokenizer& tok, RequestParameters& params);
+    static const char* getParseError(const JsonTokenizer& tok);
     void addChannelStatesToCmd(JsonObject& root, const RGBWWLed::ChannelList& channels);
 
-    bool onSingleColorCommand(JsonObject& root, String& errorMsg);
+    bool startEasedFade(const RequestParameters& params, String& errorMsg);
+    bool compileAnimationStep(const RequestParameters& params, int idx, AnimationProgram::Step& step, String& errorMsg);
+    bool onColorBatch(const char* pCmds, size_t len, String& msg, JsonArray* pResults);
+    int processBatch(const char* pCmds, size_t len, bool execute, int& numCmds, String& msg, JsonArray* pResults);
+    bool executeColorCommand(const RequestParameters& params, String& errorMsg);
 };
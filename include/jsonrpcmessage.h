@@ -31,3 +31,43 @@ private:
     DynamicJsonBuffer _jsonBuffer;
 };
 
+
+/**
+ * Serializes a JSON-RPC notification into a fixed, caller provided buffer
+ *
+ * Used on hot paths (e.g. color events during fades) where building a
+ * JsonRpcMessage would allocate a JSON buffer and a String for each message.
+ * Nesting is limited to _maxDepth objects and string values are not escaped.
+ */
+class JsonRpcStaticMessage {
+public:
+    JsonRpcStaticMessage(char* pBuf, size_t size, const char* method);
+
+    void beginObject(const char* key);
+    void endObject();
+
+    void add(const char* key, int32_t value);
+    void add(const char* key, const char* value);
+    void addFixed2(const char* key, int32_t hundredths);
+
+    void setId(int id);
+
+    const char* getData() const { return _pBuf; }
+    size_t getLength() const { return _pos; }
+    bool isValid() const { return !_overflow; }
+
+private:
+    void addKey(const char* key);
+    void addRaw(const char* str);
+    void addChar(char c);
+    void addNumber(int32_t value);
+
+    static const int _maxDepth = 4;
+
+    char* _pBuf;
+    size_t _size;
+    size_t _pos = 0;
+    bool _overflow = false;
+    int _depth = 0;
+    bool _needComma[_maxDepth + 1];
+};
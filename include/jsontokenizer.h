@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Single pass JSON tokenizer working directly on the input buffer
+ *
+ * No DOM is built: next() returns one token at a time together with the key
+ * it belongs to (inside objects). Keys and scalar values are copied into small
+ * fixed buffers. Longer keys are truncated (they cannot match any known key),
+ * longer values are an error (see isTruncated()). Values inside objects and
+ * arrays must be separated by exactly one comma. Nesting is limited to
+ * _maxDepth levels.
+ */
+class JsonTokenizer {
+public:
+    enum class Token {
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        String,
+        Number,
+        Literal,    // true, false, null
+        End,
+        Error,
+    };
+
+    JsonTokenizer(const char* pData, size_t len) : _pData(pData), _len(len) {}
+
+    Token next();
+
+    // skips the rest of the object/array opened by the last BeginObject/BeginArray
+    bool skip();
+
+    // key of the last token (empty inside arrays)
+    const char* getKey() const { return _key; }
+    bool isKey(const char* key) const;
+
+    // text of the last String, Number or Literal token
+    const char* getValue() const { return _value; }
+    bool isValue(const char* value) const;
+
+    // true if the last Error was a value longer than _maxValueLen - 1
+    bool isTruncated() const { return _truncated; }
+
+    // depth after the last token (1 inside the outer object)
+    int getDepth() const { return _depth; }
+
+    // offsets of the last token in the input, the end is exclusive
+    size_t getTokenStart() const { return _tokenStart; }
+    size_t getPos() const { return _pos; }
+
+private:
+    static const int _maxDepth = 8;
+    static const size_t _maxKeyLen = 16;
+    static const size_t _maxValueLen = 48;
+
+    void skipWhitespace();
+    bool readString(char* pBuf, size_t size);
+    bool readScalar();
+    Token error();
+
+    const char* _pData;
+    size_t _len;
+    size_t _pos = 0;
+    size_t _tokenStart = 0;
+
+    // bit n set: level n+1 is an array
+    uint8_t _arrayBits = 0;
+    int _depth = 0;
+    // a value was completed at the current level, a separator must follow
+    bool _afterValue = false;
+
+    char _key[_maxKeyLen] = { 0 };
+    char _value[_maxValueLen] = { 0 };
+    bool _truncated = false;
+};
@@ -24,8 +24,6 @@
 #include "mqtt.h"
 #include "stepsync.h"
 
-#define APP_COLOR_FILE ".color"
-
 struct PinConfig {
     PinConfig() : red(13), green(12), blue(14), warmwhite(5), coldwhite(4) {}
 
@@ -36,54 +34,15 @@ struct PinConfig {
     int coldwhite;
 };
 
-struct ColorStorage {
-    HSVCT current;
-
-    void load(bool print = false) {
-        StaticJsonBuffer < 72 > jsonBuffer;
-        if (exist()) {
-            int size = fileGetSize(APP_COLOR_FILE);
-            char* jsonString = new char[size + 1];
-            fileGetContent(APP_COLOR_FILE, jsonString, size + 1);
-            JsonObject& root = jsonBuffer.parseObject(jsonString);
-            current.h = root["h"];
-            current.s = root["s"];
-            current.v = root["v"];
-            current.ct = root["ct"];
-            if (print) {
-                root.prettyPrintTo(Serial);
-            }
-            delete[] jsonString;
-        }
-    }
-
-    void save(bool print = false) {
-        debug_d("Saving ColorStorage to file...");
-        DynamicJsonBuffer jsonBuffer;
-        JsonObject& root = jsonBuffer.createObject();
-        root["h"] = current.h;
-        root["s"] = current.s;
-        root["v"] = current.v;
-        root["ct"] = current.ct;
-        String rootString;
-        if (print) {
-            root.prettyPrintTo(Serial);
-        }
-        root.printTo(rootString);
-        fileSetContent(APP_COLOR_FILE, rootString);
-    }
-    bool exist() {
-        return fileExist(APP_COLOR_FILE);
-    }
-};
-
 class APPLedCtrl: public RGBWWLed {
 
 public:
     virtual ~APPLedCtrl();
 
     void init();
-    void setup();
+
+    // applies the color config, returns false if it did not change
+    bool setup();
 
     void start();
     void stop();
@@ -91,23 +50,72 @@ public:
     void colorReset();
     void testChannels();
 
+    // timer stage: renders the steps and writes the PWM, everything else is
+    // left to processDeferred() which runs from the system task queue. Both
+    // run in the same cooperative context, so a long deferred task still
+    // delays the next tick; the split only keeps the tick itself short.
     void updateLed();
-    void onMasterClock(uint32_t steps);
+    // masterPhaseUs: time since the step of the master began, -1 if unknown
+    void onMasterClock(uint32_t steps, int32_t masterPhaseUs = -1);
     void onMasterClockReset();
+    void onColorSyncSample(uint32_t stepsMaster, ColorSyncBuffer::Mode mode, const int vals[5]);
     virtual void onAnimationFinished(const String& name, bool requeued);
+
+    TickStats& getTickStats() { return _tickStats; }
+    SyncTelemetry& getSyncTelemetry() { return _syncTelemetry; }
+    uint32_t getStepCounter() const { return _stepCounter; }
+    // local step and the time since it began in us, also between the ticks
+    // of idle mode
+    uint32_t getStepPosition(uint32_t& phaseUs) const;
+    AnimationPlayer& getAnimationPlayer() { return _animationPlayer; }
+    FadeEngine& getFadeEngine() { return _fadeEngine; }
+
+    // stops animation programs and eased fades of the application
+    void stopAppAnimations();
+
+    // applies the publish intervals of the config
+    void setupSchedule();
+
+    // creates the clock controller selected in the config
+    void setupStepSync();
+
+    // leaves idle mode, to be called when a command changes the output
+    void wake();
+    bool isIdle() const { return _idle; }
+
+    // published by processDeferred() with the transition_finished interval,
+    // safe to call from the timer stage
+    void addFinishedAnimation(const String& name, bool requeued);
+
 private:
     static PinConfig parsePinConfigString(String& pinStr);
     static void updateLedCb(void* pTimerArg);
+    static void processDeferredCb(uint32_t param);
+    void processDeferred();
+    void collectFinishedAnimations();
     void publishToEventServer();
     void publishToMqtt();
     void publishFinishedStepAnimations();
     void publishColorStayedCmds();
-    void checkStableColorState();
+    void checkStableColorState(uint32_t steps);
+    void checkIdle(uint32_t steps);
+    void mirrorState();
+    bool resumeState();
     void publishStatus();
+    void processColorSync();
+    void applyColorSync(ColorSyncBuffer::Mode mode, const int vals[5]);
+    void applyColorDirect(bool raw, const int vals[5]);
+    void processFade();
 
     ColorStorage colorStorage;
+    RtcState _rtcState;
+
+    // color config last pushed into colorutils
+    struct ApplicationSettings::color _appliedColor;
+    bool _colorApplied = false;
 
     StepSync* _stepSync = nullptr;
+    String _stepSyncController;
 
     uint32_t _stepCounter = 0;
     HSVCT _prevColor;
@@ -118,6 +126,42 @@ private:
 
     ETSTimer _ledTimer;
     uint32_t _timerInterval = RGBWW_MINTIMEDIFF_US;
+    uint32_t _lastTickUs = 0;
+    uint32_t _armedIntervalUs = RGBWW_MINTIMEDIFF_US;
+
+    // one-shot change of the next tick which aligns the steps with the master
+    int32_t _phaseCorrectionUs = 0;
+
+    // idle mode: the output did not change for _idleAfterSteps, so the timer
+    // only fires every _idleTickSteps steps and each tick renders all of them
+    static const uint32_t _idleAfterSteps = 2 * RGBWW_UPDATEFREQUENCY;
+    static const uint32_t _idleTickSteps = 10;
+    bool _idle = false;
+    uint32_t _tickSteps = 1;
+    uint32_t _numStableOutputSteps = 0;
     HashMap<String, bool> _stepFinishedAnimations;
+
+    // finished animations of the timer stage, copied without heap allocation
+    // and moved to _stepFinishedAnimations by processDeferred()
+    struct FinishedAnimation {
+        char name[32];
+        bool requeued;
+    };
+    static const uint8_t _maxFinishedAnimations = 8;
+    FinishedAnimation _finishedAnimations[_maxFinishedAnimations];
+    uint8_t _numFinishedAnimations = 0;
     uint32_t _lastColorEvent = 0;
+
+    // work of the ticks since the last processDeferred()
+    uint32_t _deferredDue = 0;
+    uint32_t _deferredSteps = 0;
+    bool _deferredAnimFinished = false;
+    bool _deferredQueued = false;
+
+    TickStats _tickStats;
+    SyncTelemetry _syncTelemetry;
+    TickScheduler _scheduler;
+    ColorSyncBuffer _colorSync;
+    AnimationPlayer _animationPlayer;
+    FadeEngine _fadeEngine;
 };
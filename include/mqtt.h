@@ -4,6 +4,23 @@
 
 class IMasterClockSink;
 
+/**
+ * MQTT client of the controller
+ *
+ * Color updates and status values are not published directly from the LED
+ * tick but collected in an outbox (latest value per topic wins) which is
+ * flushed every network.mqtt.publish_interval_ms. Clock, command and
+ * transition_finished messages are published immediately.
+ *
+ * With sync.color_master_binary the color topic carries a binary frame instead
+ * of a JSON command (all values little endian):
+ *   [0xC5][mode:1][step counter:4] followed by
+ *   mode 1 (hsv): h, s, v, ct as uint16 (14 bytes in total)
+ *   mode 2 (raw): r, g, b, ww, cw packed as 5x10 bit (13 bytes in total)
+ * The frame always contains 0 bytes, which the String based MQTT API cannot
+ * carry, so it is published as '#' followed by the frame in hex.
+ * Slaves accept both formats on the same topic, JSON always starts with '{'.
+ */
 
 class AppMqttClient{
 
@@ -23,14 +40,27 @@ public:
     void publishClockInterval(uint32_t curInterval);
     void publishClockSlaveOffset(uint32_t offset);
     void publishCommand(const String& method, const JsonObject& params);
+    void publishCommand(const String& method, const String& paramsJson);
     void publishTransitionFinished(const String& name, bool requeued);
 
+    void getOutboxStats(JsonObject& root) const;
+
+    static const size_t _colorFrameMaxSize = 14;
+
+    // binary color frame into pBuf (_colorFrameMaxSize bytes), hsv if pHsv
+    // is set, raw otherwise; returns its length
+    static size_t buildColorFrame(uint8_t* pBuf, uint32_t steps, const HSVCT* pHsv, const ChannelOutput& raw);
+    void onColorFrame(const uint8_t* pData, size_t len);
+
 private:
     void connectDelayed(int delay = 2000);
     void connect();
     void onComplete(TcpClient& client, bool success);
     void onMessageReceived(String topic, String message);
     void publish(const String& topic, const String& data, bool retain);
+    void queue(const String& topic, const String& data, bool retain);
+    void flushOutbox();
+    void flushColor();
 
     String buildTopic(const String& suffix);
 
@@ -42,4 +72,35 @@ private:
 
     HSVCT _lastHsv;
     ChannelOutput _lastRaw;
+
+    enum class PendingColor {
+        None,
+        Hsv,
+        Raw,
+    };
+
+    struct OutboxEntry {
+        String topic;
+        String data;
+        bool retain = false;
+    };
+
+    enum ColorFrameMode {
+        ColorFrameHsv = 1,
+        ColorFrameRaw = 2,
+    };
+
+    static const uint8_t _colorFrameMagic = 0xC5;
+    static const char _colorFrameHexPrefix = '#';
+    static const int _outboxSize = 4;
+
+    Timer _outboxTimer;
+    PendingColor _pendingColor = PendingColor::None;
+    uint32_t _pendingStep = 0;
+    OutboxEntry _outbox[_outboxSize];
+    int _numOutbox = 0;
+
+    uint32_t _numPublished = 0;
+    uint32_t _numCoalesced = 0;
+    uint32_t _numDropped = 0;
 };
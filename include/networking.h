@@ -45,6 +45,8 @@ public:
     String get_con_err_msg() { return _client_err_msg; };
 
     void startAp();
+    void applyIpConfig();
+    void applyApConfig();
     void stopAp();
     void stopAp(int delay);
     bool isApActive() { return WifiAccessPoint.isEnabled(); };
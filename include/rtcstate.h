@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * Mirror of the output state in RTC user memory
+ *
+ * RTC memory survives soft resets, watchdog resets and OTA reboots but not a
+ * power loss. The state is protected by a magic and a checksum, so after a
+ * power loss load() fails and the controller falls back to ColorStorage.
+ */
+class RtcState {
+public:
+    struct State {
+        uint8_t raw;
+        uint8_t ease;           // 0xff: no eased fade
+        uint8_t fadeDirection;
+        uint8_t animationStep;
+        uint16_t hsv[4];
+        uint16_t output[5];
+        // the whole eased fade, so it continues on its curve and hue way
+        uint16_t fadeFrom[5];
+        int16_t fadeDelta[5];
+        uint32_t fadeSteps;
+        uint32_t fadeStep;
+        char animation[AnimationProgram::_maxNameLen + 1];  // empty: no program
+    };
+
+    bool load(State& state);
+
+    // only writes if the state changed since the last write
+    void save(const State& state);
+
+private:
+    struct Block {
+        uint32_t magic;
+        uint32_t checksum;
+        State state;
+    };
+    static_assert(sizeof(Block) % 4 == 0, "RTC memory is written in 4 byte blocks");
+
+    // behind the data of rboot (block 64)
+    static const uint8_t _firstBlock = 96;
+    static const uint32_t _magic = 0x52474257;
+
+    static uint32_t calcChecksum(const State& state);
+
+    Block _block;
+    bool _valid = false;
+};
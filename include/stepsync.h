@@ -5,7 +5,9 @@
 
 class StepSync {
 public:
-    virtual uint32_t onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster) = 0;
+    // phaseErrorUs: sub-step error to the master which the caller already
+    // corrected with a one-shot shift of the next tick, 0 if unknown
+    virtual uint32_t onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster, int32_t phaseErrorUs) = 0;
     virtual int getCatchupOffset() const;
     virtual uint32_t reset() = 0;
 
@@ -27,7 +29,7 @@ protected:
 
 class ClockCatchUp : public StepSync {
 public:
-    virtual uint32_t onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster) override;
+    virtual uint32_t onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster, int32_t phaseErrorUs) override;
     virtual int getCatchupOffset() const;
     virtual uint32_t reset();
 
@@ -35,6 +37,52 @@ private:
     uint32_t _stepsSyncMasterLast = 0;
     uint32_t _stepsSyncLast = 0;
     bool _firstMasterSync = true;
-    double _steering = 1.0;
+    // Q16 fixed point, _steeringOne is 1.0
+    static const int32_t _steeringOne = 1 << 16;
+    int32_t _steering = _steeringOne;
+    const uint32_t _constBaseInt = RGBWW_MINTIMEDIFF_US;
+};
+
+
+/**
+ * Clock discipline with a PI loop
+ *
+ * The phase error is the accumulated step offset to the master, the
+ * integral term estimates the frequency error of the local timer. Once that
+ * is learned the slave keeps the rate of the master between sync messages and
+ * the proportional term only has to remove the remaining phase error.
+ * The integral is updated before it is used, so per sync message the loop
+ * has the characteristic polynomial z^2 - (2 - Kp - Ki) z + (1 - Kp). With
+ * Kp = 1/2 and Ki = 1/16 both poles are real (0.85 and 0.59): the offset does
+ * not oscillate after a jump, it undershoots once by about 15% and decays by
+ * 0.85 per message (tests/host/stepsync_test.cpp).
+ * A sub-step phase error (UDP sync) was already removed by the caller, it only
+ * feeds the frequency, with the larger gain 1 / 2^_kfShift.
+ * tools/syncsim.py simulates this loop and ClockCatchUp with this code.
+ */
+class ClockPI : public StepSync {
+public:
+    virtual uint32_t onMasterClock(uint32_t stepsCurrent, uint32_t stepsMaster, int32_t phaseErrorUs) override;
+    virtual int getCatchupOffset() const;
+    virtual uint32_t reset();
+
+    // frequency correction in 1/65536
+    int32_t getFrequency() const { return _freq; }
+
+private:
+    uint32_t _stepsSyncMasterLast = 0;
+    uint32_t _stepsSyncLast = 0;
+    bool _firstMasterSync = true;
+
+    // Q16 fixed point, _steeringOne is 1.0
+    static const int32_t _steeringOne = 1 << 16;
+    // Kp = 1/2, Ki = 1/16
+    static const int _kpShift = 1;
+    static const int _kiShift = 4;
+    static const int _kfShift = 2;
+    // the timer of the ESP is off by far less than 1/32
+    static const int32_t _maxFreq = _steeringOne / 32;
+
+    int32_t _freq = 0;
     const uint32_t _constBaseInt = RGBWW_MINTIMEDIFF_US;
 };
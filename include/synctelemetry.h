@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SmingCore/SmingCore.h>
+
+
+/**
+ * Ring of the last _numSamples master clock messages a slave processed
+ *
+ * Each sample holds the step counters of master and slave, the accumulated
+ * offset and the timer interval chosen by the clock controller and the
+ * arrival jitter of the message (time since the previous message minus the
+ * steps the master advanced). The summary covers all samples since the last
+ * reset, the convergence time is measured from the first sample until the
+ * offset stays within _convergedSteps.
+ */
+class SyncTelemetry {
+public:
+    struct Sample {
+        uint32_t timeMs;
+        uint32_t stepsMaster;
+        uint32_t stepsLocal;
+        int32_t offset;
+        int32_t phaseErrorUs;
+        int32_t jitterMs;
+        uint32_t intervalUs;
+        bool udp;
+    };
+
+    SyncTelemetry();
+
+    void reset();
+
+    // phaseErrorUs is only known for UDP sync (udp = true), 0 otherwise
+    void addSample(uint32_t stepsMaster, uint32_t stepsLocal, int32_t offset, int32_t phaseErrorUs,
+            uint32_t intervalUs, bool udp);
+
+    uint32_t getNumSamples() const { return _numTotal < _numSamples ? _numTotal : _numSamples; }
+
+    // maxSamples limits the ring entries, the newest ones are kept
+    void toJson(JsonObject& root, uint32_t maxSamples = _numSamples) const;
+
+private:
+    static const uint32_t _numSamples = 32;
+    static const int32_t _convergedSteps = 1;
+
+    Sample _samples[_numSamples];
+    uint32_t _next = 0;
+    uint32_t _numTotal = 0;
+
+    uint32_t _startMs = 0;
+    uint32_t _convergedMs = 0;
+    bool _converged = false;
+
+    int64_t _offsetSum = 0;
+    int32_t _offsetMax = 0;
+    int32_t _jitterMax = 0;
+    uint32_t _phaseErrorSum = 0;
+    uint32_t _numPhase = 0;
+};
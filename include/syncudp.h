@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * UDP multicast transport for clock and color sync
+ *
+ * Masters send their clock and color to sync.udp_group:sync.udp_port in
+ * addition to MQTT, so slaves in the same LAN get them without the latency
+ * of the broker. Packets (little endian):
+ *   ['R']['S'][version:1][type:1][epoch:4][sequence:4][master time us:4][payload]
+ *   clock: [step counter:4][time since the step began us:2]
+ *   clock reset: no payload
+ *   color: binary color frame as published on MQTT, but not hex encoded (see mqtt.h)
+ * The epoch is random for each start of the master, so the sequence of a
+ * rebooted master is not mistaken for old packets, even if it only syncs the
+ * color and never sends a clock reset. Within an epoch slaves drop duplicated
+ * and reordered packets by the sequence number. As long
+ * as clock packets arrive, clock messages received via MQTT are ignored so the
+ * clock controller is not fed twice; MQTT stays the fallback for routed
+ * networks.
+ */
+class SyncUdp {
+public:
+    ~SyncUdp();
+
+    // (re)starts with the sync config, needs a station ip to join the group
+    void start();
+    void stop();
+    bool isRunning() const { return _udp != nullptr; }
+
+    // phaseUs: time since the step began, see APPLedCtrl::getStepPosition
+    void publishClock(uint32_t steps, uint32_t phaseUs);
+    void publishClockReset();
+    void publishColor(uint32_t steps, const HSVCT* pHsv, const ChannelOutput& raw);
+
+    // true while clock packets arrive, MQTT clock messages are ignored then
+    bool hasClock() const;
+
+    void getStats(JsonObject& root) const;
+
+    enum PacketType {
+        PacketClock = 1,
+        PacketClockReset = 2,
+        PacketColor = 3,
+    };
+
+private:
+    void send(PacketType type, const uint8_t* pPayload, size_t len);
+    void onReceive(UdpConnection& connection, char* data, int size, IPAddress remoteIP, uint16_t remotePort);
+
+    static const uint8_t _version = 2;
+    static const size_t _headerSize = 16;
+    static const size_t _maxPayloadSize = 16;
+    // unchanged colors are repeated, so lost packets heal
+    static const uint32_t _colorRepeatMs = 1000;
+
+    UdpConnection* _udp = nullptr;
+    IPAddress _group;
+    bool _joined = false;
+
+    // master
+    uint32_t _txEpoch = 0;
+    uint32_t _txSeq = 0;
+    bool _firstClock = true;
+    uint8_t _lastColorFrame[AppMqttClient::_colorFrameMaxSize];
+    size_t _lastColorFrameLen = 0;
+    uint32_t _lastColorMs = 0;
+
+    // slave: epoch and sequence of the current master
+    IPAddress _rxSender;
+    uint32_t _rxEpoch = 0;
+    uint32_t _rxSeq = 0;
+    bool _rxSeqValid = false;
+    uint32_t _lastClockMs = 0;
+    uint32_t _clockIntervalMs = 0;
+    bool _clockReceived = false;
+
+    uint32_t _numSent = 0;
+    uint32_t _numReceived = 0;
+    uint32_t _numLost = 0;
+    uint32_t _numDuplicates = 0;
+    uint32_t _numRestarts = 0;
+    uint32_t _numInvalid = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * Deadline scheduler for the periodic publishers of the LED tick
+ *
+ * Each task has an interval in ms on the step timeline (steps times step
+ * length) and the time it is due next. Deadlines are compared by signed
+ * difference, so the timeline may wrap. A tick only compares the timeline
+ * against the earliest deadline; the task slots are scanned when something is
+ * due. With the handful of tasks of the controller this is cheaper than a
+ * heap and needs no division.
+ */
+class TickScheduler {
+public:
+    enum Task {
+        TaskClockMaster = 0,
+        TaskColorEvent,
+        TaskColorMqtt,
+        TaskTransitionFinished,
+        TaskCount,
+    };
+
+    // intervalMs < 0 disables the task, 0 runs it every tick
+    void setInterval(Task task, int intervalMs);
+
+    // advances the timeline, returns the due tasks as bit mask (1 << Task)
+    uint32_t advance(uint32_t elapsedMs);
+
+    static bool isSet(uint32_t mask, Task task) { return (mask & (1 << task)) != 0; }
+
+private:
+    struct Entry {
+        int intervalMs = -1;
+        uint32_t due = 0;
+    };
+
+    void updateNextDue();
+
+    Entry _entries[TaskCount];
+    uint32_t _nowMs = 0;
+    uint32_t _nextDue = 0;
+    bool _hasTasks = false;
+};
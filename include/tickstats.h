@@ -0,0 +1,66 @@
+#pragma once
+
+#include <SmingCore/SmingCore.h>
+
+
+/**
+ * Lightweight profiler for the LED render tick
+ *
+ * Collects a latency histogram of the timer stage of the tick
+ * (APPLedCtrl::updateLed()), the time spent in each stage including the
+ * deferred ones of APPLedCtrl::processDeferred(), the jitter of the timer
+ * arrival versus the requested interval and the free heap drift across the
+ * timer stage.
+ */
+class TickStats {
+public:
+    enum Stage {
+        StageRender = 0,
+        StageClock,
+        StageEvents,
+        StageMqtt,
+        StageStableCheck,
+        StageTransFin,
+        StageCount,
+    };
+
+    TickStats();
+
+    void reset();
+
+    void beginTick(uint32_t expectedIntervalUs);
+    void stageDone(Stage stage);
+    void endTick();
+
+    // the following stages run in the deferred task
+    void beginDeferred();
+
+    uint32_t getPercentile(uint8_t percent) const;
+    void toJson(JsonObject& root) const;
+
+private:
+    static const char* getStageName(Stage stage);
+
+    static const uint32_t _bucketWidthUs = 50;
+    static const uint32_t _numBuckets = 80;
+
+    uint32_t _histogram[_numBuckets];
+    uint32_t _stageSumUs[StageCount];
+    uint32_t _stageMaxUs[StageCount];
+
+    uint32_t _numTicks = 0;
+    uint32_t _tickSumUs = 0;
+    uint32_t _tickMaxUs = 0;
+
+    uint32_t _jitterSumUs = 0;
+    uint32_t _jitterMaxUs = 0;
+
+    uint32_t _heapChangedTicks = 0;
+    uint32_t _heapMaxDrop = 0;
+    uint32_t _heapMin = 0;
+
+    uint32_t _tickStart = 0;
+    uint32_t _stageStart = 0;
+    uint32_t _prevTickStart = 0;
+    uint32_t _heapStart = 0;
+};
@@ -73,6 +73,8 @@ private:
     void onPause(HttpRequest &request, HttpResponse &response);
     void onContinue(HttpRequest &request, HttpResponse &response);
     void onBlink(HttpRequest &request, HttpResponse &response);
+    void onTickStats(HttpRequest &request, HttpResponse &response);
+    void onSync(HttpRequest &request, HttpResponse &response);
 
     void onColorGet(HttpRequest &request, HttpResponse &response);
     void onColorPost(HttpRequest &request, HttpResponse &response);
@@ -0,0 +1,101 @@
+#include <binaryframe.h>
+#include <string.h>
+
+#include "hosttest.h"
+
+
+// same layout as AppMqttClient::buildColorFrame() (raw mode)
+static size_t buildRawFrame(uint8_t* pBuf, size_t size, uint32_t steps, const uint16_t vals[5]) {
+    BinaryFrameWriter frame(pBuf, size);
+    frame.put8(0xC5);
+    frame.put8(2);
+    frame.put32(steps);
+    frame.putPacked10(vals[0], vals[1], vals[2], vals[3], vals[4]);
+    return frame.isValid() ? frame.getLength() : 0;
+}
+
+static void testPacked10() {
+    const uint16_t vals[][5] = {
+        { 0, 0, 0, 0, 0 },
+        { 1023, 1023, 1023, 1023, 1023 },
+        { 1, 2, 3, 4, 5 },
+        { 1023, 0, 512, 0, 1023 },
+    };
+
+    for(const auto& in : vals) {
+        uint8_t buf[7];
+        BinaryFrameWriter writer(buf, sizeof(buf));
+        writer.putPacked10(in[0], in[1], in[2], in[3], in[4]);
+        CHECK(writer.isValid());
+        CHECK_EQ(writer.getLength(), 7);
+
+        uint16_t out[5];
+        BinaryFrameReader reader(buf, writer.getLength());
+        reader.getPacked10(out);
+        CHECK(reader.isValid());
+        for(int i=0; i < 5; ++i)
+            CHECK_EQ(out[i], in[i]);
+    }
+}
+
+static void testOverflow() {
+    uint8_t buf[3];
+    BinaryFrameWriter writer(buf, sizeof(buf));
+    writer.put32(1);
+    CHECK(!writer.isValid());
+
+    BinaryFrameReader reader(buf, 2);
+    reader.get16();
+    CHECK(reader.isValid());
+    CHECK_EQ(reader.get8(), 0);
+    CHECK(!reader.isValid());
+}
+
+static void testHexRoundTrip() {
+    // color frames always contain 0 bytes, e.g. the high bytes of small step counters
+    const uint16_t vals[5] = { 0, 1023, 0, 17, 0 };
+    const uint32_t steps[] = { 0, 1, 0x100, 0xffffffff };
+
+    for(uint32_t s : steps) {
+        uint8_t frame[14];
+        const size_t len = buildRawFrame(frame, sizeof(frame), s, vals);
+        CHECK_EQ(len, 13);
+        CHECK(memchr(frame, 0, len) != NULL);
+
+        char text[2 * sizeof(frame) + 1];
+        BinaryFrameHex::encode(frame, len, text);
+        CHECK_EQ(strlen(text), 2 * len);
+
+        uint8_t decoded[14];
+        CHECK_EQ(BinaryFrameHex::decode(text, strlen(text), decoded, sizeof(decoded)), len);
+        CHECK(memcmp(frame, decoded, len) == 0);
+
+        BinaryFrameReader reader(decoded, len);
+        CHECK_EQ(reader.get8(), 0xC5);
+        CHECK_EQ(reader.get8(), 2);
+        CHECK_EQ(reader.get32(), s);
+        uint16_t out[5];
+        reader.getPacked10(out);
+        CHECK(reader.isValid());
+        for(int i=0; i < 5; ++i)
+            CHECK_EQ(out[i], vals[i]);
+    }
+}
+
+static void testHexInvalid() {
+    uint8_t buf[4];
+    CHECK_EQ(BinaryFrameHex::decode("abc", 3, buf, sizeof(buf)), 0);
+    CHECK_EQ(BinaryFrameHex::decode("zz", 2, buf, sizeof(buf)), 0);
+    CHECK_EQ(BinaryFrameHex::decode("0011223344", 10, buf, sizeof(buf)), 0);
+    CHECK_EQ(BinaryFrameHex::decode("A0ff", 4, buf, sizeof(buf)), 2);
+    CHECK_EQ(buf[0], 0xa0);
+    CHECK_EQ(buf[1], 0xff);
+}
+
+int main() {
+    testPacked10();
+    testOverflow();
+    testHexRoundTrip();
+    testHexInvalid();
+    return hostTestResult();
+}
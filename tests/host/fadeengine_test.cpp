@@ -0,0 +1,289 @@
+#include <RGBWWCtrl.h>
+#include <math.h>
+
+#include "hosttest.h"
+
+
+/**
+ * Reference model of FadeEngine
+ *
+ * Computes each step directly from its index in 64 bit (no accumulators, no
+ * 32 bit intermediate values) and builds the curve tables from their
+ * formulas, so it checks the fixed point shortcuts of the engine, including
+ * the products near the 32 bit limits.
+ */
+namespace ref {
+
+typedef FadeEngine::Ease Ease;
+
+const int64_t one = 1 << 16;
+const int tableSize = 33;
+
+double curve(Ease ease, double p) {
+    switch(ease) {
+    case Ease::In:
+        return p * p;
+    case Ease::Out:
+        return 1 - (1 - p) * (1 - p);
+    case Ease::InOut:
+        return p < 0.5 ? 2 * p * p : 1 - 2 * (1 - p) * (1 - p);
+    case Ease::Cubic:
+        return p < 0.5 ? 4 * p * p * p : 1 - 4 * (1 - p) * (1 - p) * (1 - p);
+    default:
+        return p;
+    }
+}
+
+// CIE 1976 luminance of the lightness p (0..1)
+double luminance(double p) {
+    const double l = p * 100;
+    return l > 8 ? pow((l + 16) / 116, 3) : l / 903.3;
+}
+
+struct Tables {
+    int64_t curves[8][tableSize];
+    int64_t lightness[tableSize];
+
+    Tables() {
+        for(int e=0; e < 8; ++e)
+            for(int i=0; i < tableSize; ++i)
+                curves[e][i] = llround(curve(static_cast<Ease>(e), static_cast<double>(i) / (tableSize - 1)) * 65535);
+        for(int i=0; i < tableSize; ++i)
+            lightness[i] = llround(luminance(static_cast<double>(i) / (tableSize - 1)) * 65535);
+    }
+};
+
+const Tables tables;
+
+int64_t interpolate(const int64_t* pTable, int64_t x, int bits) {
+    const int64_t idx = x >> bits;
+    if (idx >= tableSize - 1)
+        return pTable[tableSize - 1];
+    const int64_t frac = x - (idx << bits);
+    return pTable[idx] + (((pTable[idx + 1] - pTable[idx]) * frac + (1 << (bits - 1))) >> bits);
+}
+
+int64_t ease(Ease e, int64_t pos) {
+    if (pos >= one)
+        return one;
+    switch(e) {
+    case Ease::Smooth:
+    {
+        // 3p^2 - 2p^3 with the truncation of each product to Q16
+        const int64_t p2 = (pos * pos) >> 16;
+        return 3 * p2 - ((p2 * pos) >> 15);
+    }
+    case Ease::In:
+    case Ease::Out:
+    case Ease::InOut:
+    case Ease::Cubic:
+        return interpolate(tables.curves[static_cast<int>(e)], pos, 11);
+    default:
+        return pos;
+    }
+}
+
+int64_t toLightness(int64_t val) {
+    // largest lightness (Q15) whose luminance does not exceed the value,
+    // memoized as the scan is slow
+    static int64_t cache[RGBWW_CALC_MAXVAL + 1];
+    static bool cached[RGBWW_CALC_MAXVAL + 1];
+    if (!cached[val]) {
+        const int64_t lum = val * 65535 / RGBWW_CALC_MAXVAL;
+        int64_t l = 0;
+        while (l < (1 << 15) && interpolate(tables.lightness, l + 1, 10) <= lum)
+            ++l;
+        cache[val] = l;
+        cached[val] = true;
+    }
+    return cache[val];
+}
+
+int64_t fromLightness(int64_t l, int64_t maxVal) {
+    return (interpolate(tables.lightness, l, 10) * maxVal + 32767) / 65535;
+}
+
+int64_t roundQ16(int64_t scaled) {
+    return scaled >= 0 ? (scaled + 0x8000) >> 16 : -((-scaled + 0x8000) >> 16);
+}
+
+// values after step k (1..steps) of a fade
+void value(bool raw, const int from[5], const int to[5], uint32_t steps, Ease e, int direction, uint64_t k, int out[5]) {
+    if (steps == 0)
+        steps = 1;
+
+    int64_t delta[5];
+    for(int i=0; i < 5; ++i)
+        delta[i] = to[i] - from[i];
+
+    const int64_t period = RGBWW_CALC_HUEWHEELMAX;
+    if (!raw) {
+        if (delta[0] > period / 2)
+            delta[0] -= period;
+        else if (delta[0] < -period / 2)
+            delta[0] += period;
+        if (direction != 1 && delta[0] != 0)
+            delta[0] += delta[0] > 0 ? -period : period;
+    }
+
+    const int64_t pos = k >= steps ? one : static_cast<int64_t>(k) * one / steps;
+    const int64_t eased = ease(e, pos);
+    for(int i=0; i < 5; ++i) {
+        const bool lightness = e == Ease::Log && (raw || i == 2);
+        if (pos >= one)
+            out[i] = from[i] + delta[i];
+        else if (lightness) {
+            const int64_t fromL = toLightness(from[i]);
+            const int64_t deltaL = toLightness(to[i]) - fromL;
+            out[i] = fromLightness(fromL + roundQ16(deltaL * eased), RGBWW_CALC_MAXVAL);
+        }
+        else
+            out[i] = from[i] + roundQ16(delta[i] * eased);
+    }
+
+    if (!raw) {
+        if (out[0] < 0)
+            out[0] += period;
+        else if (out[0] >= period)
+            out[0] -= period;
+    }
+}
+
+}  // namespace ref
+
+
+static const FadeEngine::Ease allEases[] = {
+    FadeEngine::Ease::Linear,
+    FadeEngine::Ease::Smooth,
+    FadeEngine::Ease::In,
+    FadeEngine::Ease::Out,
+    FadeEngine::Ease::InOut,
+    FadeEngine::Ease::Cubic,
+    FadeEngine::Ease::Log,
+};
+
+static void testEaseAllPositions() {
+    // every Q16 position, including the segment borders of the tables and
+    // the largest products of smooth (65535^2 and p2 * 65535)
+    for(FadeEngine::Ease e : allEases) {
+        int mismatches = 0;
+        for(uint32_t pos=0; pos <= 65537; ++pos) {
+            if (FadeEngine::applyEase(e, pos) != ref::ease(e, pos))
+                ++mismatches;
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK_EQ(FadeEngine::applyEase(e, 0xffffffff), 65536);
+    }
+}
+
+static void checkFade(bool raw, const int from[5], const int to[5], uint32_t steps, FadeEngine::Ease e, int direction) {
+    FadeEngine engine;
+    engine.start(raw, from, to, steps, e, direction, "");
+
+    const uint32_t numSteps = steps > 0 ? steps : 1;
+    int mismatchStep = -1;
+    bool finishedEarly = false;
+    for(uint32_t k=1; k <= numSteps; ++k) {
+        int vals[5];
+        int expected[5];
+        const bool finished = engine.process(vals);
+        if (finished != (k == numSteps))
+            finishedEarly = true;
+
+        ref::value(raw, from, to, steps, e, direction, k, expected);
+        if (mismatchStep < 0 && memcmp(vals, expected, sizeof(vals)) != 0)
+            mismatchStep = k;
+    }
+
+    if (mismatchStep >= 0 || finishedEarly)
+        printf("fade raw %d ease %d steps %u direction %d: first mismatch at step %d\n",
+                raw, static_cast<int>(e), steps, direction, mismatchStep);
+    CHECK_EQ(mismatchStep, -1);
+    CHECK(!finishedEarly);
+    CHECK(!engine.isActive());
+}
+
+static void testFades() {
+    const int maxVal = RGBWW_CALC_MAXVAL;
+    const int hueMax = RGBWW_CALC_HUEWHEELMAX;
+
+    // full range both ways, small steps and the hue wrap in both directions
+    const int hsv[][2][5] = {
+        { { 0, 0, 0, 0, 0 }, { hueMax - 1, maxVal, maxVal, 6500, 0 } },
+        { { hueMax - 1, maxVal, maxVal, 6500, 0 }, { 0, 0, 0, 2700, 0 } },
+        { { 10, 500, 1, 2700, 0 }, { 11, 501, 2, 2701, 0 } },
+        { { hueMax - 100, 200, 700, 3000, 0 }, { 100, 900, 300, 3000, 0 } },
+        { { hueMax / 2, 0, maxVal, 0, 0 }, { 0, maxVal, 0, 0, 0 } },
+    };
+    const int rawVals[][2][5] = {
+        { { 0, 0, 0, 0, 0 }, { maxVal, maxVal, maxVal, maxVal, maxVal } },
+        { { maxVal, maxVal, maxVal, maxVal, maxVal }, { 0, 0, 0, 0, 0 } },
+        { { 1, 512, 1022, 0, 3 }, { 2, 511, 1023, 1, 0 } },
+    };
+    // 65536 and more steps make the Q16 increment 0 or 1 plus a remainder
+    const uint32_t steps[] = { 0, 1, 2, 3, 7, 50, 1000, 65535, 65536, 65537, 200000 };
+
+    for(FadeEngine::Ease e : allEases) {
+        for(uint32_t s : steps) {
+            for(const auto& c : hsv) {
+                checkFade(false, c[0], c[1], s, e, 1);
+                checkFade(false, c[0], c[1], s, e, 0);
+            }
+            for(const auto& c : rawVals)
+                checkFade(true, c[0], c[1], s, e, 1);
+        }
+    }
+}
+
+static void testTarget() {
+    const int from[5] = { 100, 0, 0, 0, 0 };
+    const int to[5] = { RGBWW_CALC_HUEWHEELMAX - 100, 1, 2, 3, 4 };
+    FadeEngine engine;
+    engine.start(false, from, to, 10, FadeEngine::Ease::Smooth, 0, "x");
+
+    int target[5];
+    engine.getTarget(target);
+    for(int i=0; i < 5; ++i)
+        CHECK_EQ(target[i], to[i]);
+    CHECK_EQ(engine.getRemainingSteps(), 10);
+}
+
+static void testResume() {
+    // a long way hue fade resumed past its half must keep its way and curve
+    const int from[5] = { 100, 0, 0, 2700, 0 };
+    const int to[5] = { 300, RGBWW_CALC_MAXVAL, RGBWW_CALC_MAXVAL, 6500, 0 };
+    for(FadeEngine::Ease e : allEases) {
+        FadeEngine engine;
+        engine.start(false, from, to, 500, e, 0, "");
+        int vals[5];
+        for(int k=0; k < 321; ++k)
+            engine.process(vals);
+
+        int savedFrom[5];
+        int savedDelta[5];
+        engine.getFrom(savedFrom);
+        engine.getDelta(savedDelta);
+        FadeEngine resumed;
+        resumed.resume(false, savedFrom, savedDelta, engine.getSteps(), engine.getStep(), e, 0, "");
+        CHECK_EQ(resumed.getRemainingSteps(), engine.getRemainingSteps());
+
+        int mismatches = 0;
+        while (engine.isActive()) {
+            int expected[5];
+            engine.process(expected);
+            resumed.process(vals);
+            if (memcmp(vals, expected, sizeof(vals)) != 0)
+                ++mismatches;
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK(!resumed.isActive());
+    }
+}
+
+int main() {
+    testEaseAllPositions();
+    testTarget();
+    testResume();
+    testFades();
+    return hostTestResult();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// minimal test helpers, a failed check reports and the test exits with 1
+static int hostTestFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++hostTestFailures; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        const long long va = (a); \
+        const long long vb = (b); \
+        if (va != vb) { \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, va, vb); \
+            ++hostTestFailures; \
+        } \
+    } while (0)
+
+static int hostTestResult() {
+    if (hostTestFailures > 0) {
+        printf("%d checks failed\n", hostTestFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <jsontokenizer.h>
+#include <string.h>
+
+#include "hosttest.h"
+
+
+typedef JsonTokenizer::Token Token;
+
+// tokenizes the whole input, returns the last token (End or Error)
+static Token run(const char* json, int* pNumTokens = NULL) {
+    JsonTokenizer tok(json, strlen(json));
+    Token token;
+    int num = 0;
+    while ((token = tok.next()) != Token::End && token != Token::Error)
+        ++num;
+    if (pNumTokens)
+        *pNumTokens = num;
+    return token;
+}
+
+static void testValid() {
+    int num = 0;
+    CHECK(run("{}", &num) == Token::End);
+    CHECK_EQ(num, 2);
+    CHECK(run("{\"hsv\":{\"h\":100,\"s\":\"+10\"},\"t\":1000,\"channels\":[\"h\",\"s\"],\"r\":true}", &num) == Token::End);
+    CHECK_EQ(num, 12);
+    CHECK(run(" { \"a\" : [ ] , \"b\" : { } } ", &num) == Token::End);
+    CHECK(run("{\"cmds\":[{\"t\":1},{\"t\":2}]}") == Token::End);
+}
+
+static void testSeparators() {
+    CHECK(run("{\"a\":1 \"b\":2}") == Token::Error);
+    CHECK(run("{\"a\":1,,\"b\":2}") == Token::Error);
+    CHECK(run("{\"a\":1,}") == Token::Error);
+    CHECK(run("{,\"a\":1}") == Token::Error);
+    CHECK(run("{\"a\":[1 2]}") == Token::Error);
+    CHECK(run("{\"a\":[1,]}") == Token::Error);
+    CHECK(run("{\"a\":[,1]}") == Token::Error);
+    CHECK(run("{\"a\":{}\"b\":1}") == Token::Error);
+    CHECK(run("{\"a\":1") == Token::Error);
+    CHECK(run("{\"a\":1]") == Token::Error);
+}
+
+static void testValueLength() {
+    char json[128];
+    char value[64];
+
+    // _maxValueLen - 1 characters fit
+    memset(value, 'x', 47);
+    value[47] = 0;
+    snprintf(json, sizeof(json), "{\"name\":\"%s\"}", value);
+    JsonTokenizer tok(json, strlen(json));
+    CHECK(tok.next() == Token::BeginObject);
+    CHECK(tok.next() == Token::String);
+    CHECK(tok.isKey("name"));
+    CHECK(tok.isValue(value));
+    CHECK(!tok.isTruncated());
+
+    memset(value, 'x', 48);
+    value[48] = 0;
+    snprintf(json, sizeof(json), "{\"name\":\"%s\"}", value);
+    JsonTokenizer tokLong(json, strlen(json));
+    CHECK(tokLong.next() == Token::BeginObject);
+    CHECK(tokLong.next() == Token::Error);
+    CHECK(tokLong.isTruncated());
+    CHECK(tokLong.next() == Token::Error);
+
+    snprintf(json, sizeof(json), "{\"t\":%s}", "1000000000000000000000000000000000000000000000000");
+    JsonTokenizer tokNumber(json, strlen(json));
+    CHECK(tokNumber.next() == Token::BeginObject);
+    CHECK(tokNumber.next() == Token::Error);
+    CHECK(tokNumber.isTruncated());
+
+    // long keys are truncated, they cannot match a known key
+    const char* jsonKey = "{\"a_very_long_unknown_key\":1}";
+    JsonTokenizer tokKey(jsonKey, strlen(jsonKey));
+    CHECK(tokKey.next() == Token::BeginObject);
+    CHECK(tokKey.next() == Token::Number);
+    CHECK(!tokKey.isTruncated());
+    CHECK(tokKey.next() == Token::EndObject);
+}
+
+static void testSkip() {
+    const char* json = "{\"x\":{\"y\":[1,{\"z\":2}]},\"t\":5}";
+    JsonTokenizer tok(json, strlen(json));
+    CHECK(tok.next() == Token::BeginObject);
+    CHECK(tok.next() == Token::BeginObject);
+    CHECK(tok.skip());
+    CHECK(tok.next() == Token::Number);
+    CHECK(tok.isKey("t"));
+    CHECK(tok.isValue("5"));
+    CHECK(tok.next() == Token::EndObject);
+    CHECK(tok.next() == Token::End);
+}
+
+int main() {
+    testValid();
+    testSeparators();
+    testValueLength();
+    testSkip();
+    return hostTestResult();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Stands in for the firmware's RGBWWCtrl.h in the host tests: only what the
+// tested sources use, with the values of the RGBWWLed library
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+typedef std::string String;
+
+#define RGBWW_CALC_DEPTH 10
+#define RGBWW_CALC_MAXVAL ((1 << RGBWW_CALC_DEPTH) - 1)
+#define RGBWW_CALC_HUEWHEELMAX (RGBWW_CALC_MAXVAL * 6)
+
+#define RGBWW_UPDATEFREQUENCY 50
+#define RGBWW_MINTIMEDIFF_US (1000000 / RGBWW_UPDATEFREQUENCY)
+
+#define debug_d(...)
+
+#include <fadeengine.h>
+#include <stepsync.h>
+#include <tickscheduler.h>
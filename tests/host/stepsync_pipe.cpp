@@ -0,0 +1,42 @@
+#include <RGBWWCtrl.h>
+#include <stdio.h>
+
+
+/**
+ * Runs a clock controller of the firmware for tools/syncsim.py
+ *
+ * usage: stepsync_pipe catchup|pi
+ * Reads one command per line from stdin and answers each with the interval
+ * in us: "reset" or "<steps> <master steps> <phase error us>".
+ */
+int main(int argc, char** argv) {
+    ClockCatchUp catchup;
+    ClockPI pi;
+    StepSync* sync = nullptr;
+    if (argc == 2 && strcmp(argv[1], "catchup") == 0)
+        sync = &catchup;
+    else if (argc == 2 && strcmp(argv[1], "pi") == 0)
+        sync = &pi;
+    if (sync == nullptr) {
+        fprintf(stderr, "usage: %s catchup|pi\n", argv[0]);
+        return 2;
+    }
+
+    char line[64];
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned long steps, stepsMaster;
+        long phaseErrorUs;
+        uint32_t interval;
+        if (strncmp(line, "reset", 5) == 0)
+            interval = sync->reset();
+        else if (sscanf(line, "%lu %lu %ld", &steps, &stepsMaster, &phaseErrorUs) == 3)
+            interval = sync->onMasterClock(steps, stepsMaster, phaseErrorUs);
+        else {
+            fprintf(stderr, "invalid command: %s", line);
+            return 1;
+        }
+        printf("%u\n", static_cast<unsigned>(interval));
+        fflush(stdout);
+    }
+    return 0;
+}
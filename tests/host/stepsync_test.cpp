@@ -0,0 +1,133 @@
+#include <RGBWWCtrl.h>
+#include <algorithm>
+
+#include "hosttest.h"
+
+
+/**
+ * Slave running a clock controller against an ideal master
+ *
+ * The master sends its step counter every syncSteps steps, the message
+ * arrives without latency. The timer of the slave runs slow by driftPpm.
+ */
+class SyncModel {
+public:
+    static const uint32_t syncSteps = 1500;
+
+    SyncModel(StepSync& sync, double driftPpm) : _sync(sync), _rate(1 + driftPpm / 1e6) {
+        _interval = _sync.reset();
+    }
+
+    // runs until the next message of the master and passes it to the controller
+    void nextSync() {
+        _stepsMaster += syncSteps;
+        const double end = _stepsMaster * static_cast<double>(RGBWW_MINTIMEDIFF_US);
+        while (_time + _interval * _rate <= end) {
+            _time += _interval * _rate;
+            ++_steps;
+        }
+        _interval = _sync.onMasterClock(_steps, _stepsMaster, 0);
+    }
+
+    // the slave loses (negative) or gains steps, e.g. by a blocked timer
+    void jump(int steps) {
+        _steps += steps;
+    }
+
+    uint32_t getInterval() const { return _interval; }
+
+private:
+    StepSync& _sync;
+    const double _rate;
+    double _time = 0;
+    uint32_t _steps = 0;
+    uint32_t _stepsMaster = 0;
+    uint32_t _interval = 0;
+};
+
+static void testPIDrift() {
+    // the integral learns the drift, then the offset stays at 0
+    ClockPI pi;
+    SyncModel model(pi, 100);
+    int maxOffset = 0;
+    for(int i = 0; i < 120; ++i) {
+        model.nextSync();
+        if (i >= 20)
+            maxOffset = std::max(maxOffset, abs(pi.getCatchupOffset()));
+    }
+    CHECK_EQ(maxOffset, 0);
+    // 100 ppm of 20000 us
+    CHECK_EQ(model.getInterval(), RGBWW_MINTIMEDIFF_US - 2);
+    CHECK(pi.getFrequency() > 0);
+}
+
+static void testCatchUpDrift() {
+    // without an integral the offset builds up to a step before each correction
+    ClockCatchUp catchup;
+    SyncModel model(catchup, 100);
+    int maxOffset = 0;
+    for(int i = 0; i < 120; ++i) {
+        model.nextSync();
+        maxOffset = std::max(maxOffset, abs(catchup.getCatchupOffset()));
+    }
+    CHECK_EQ(maxOffset, 1);
+}
+
+static void testPIJump() {
+    // both poles are real: no oscillation, one undershoot of about 15%
+    ClockPI pi;
+    SyncModel model(pi, 0);
+    for(int i = 0; i < 20; ++i)
+        model.nextSync();
+    CHECK_EQ(pi.getCatchupOffset(), 0);
+
+    const int jump = 20;
+    model.jump(-jump);
+    int minOffset = 0;
+    int signChanges = 0;
+    int last = 0;
+    int settled = -1;
+    for(int i = 0; i < 60; ++i) {
+        model.nextSync();
+        const int offset = pi.getCatchupOffset();
+        minOffset = std::min(minOffset, offset);
+        // ignore the last step of quantisation noise
+        if (abs(offset) > 1) {
+            if (last != 0 && (offset > 0) != (last > 0))
+                ++signChanges;
+            last = offset;
+            settled = -1;
+        }
+        else if (settled < 0) {
+            settled = i;
+        }
+    }
+    CHECK_EQ(signChanges, 1);
+    CHECK(minOffset >= -jump / 5);
+    CHECK(settled >= 0 && settled < 20);
+    CHECK_EQ(pi.getCatchupOffset(), 0);
+    CHECK_EQ(model.getInterval(), RGBWW_MINTIMEDIFF_US);
+}
+
+static void testReset() {
+    ClockPI pi;
+    SyncModel model(pi, 500);
+    for(int i = 0; i < 10; ++i)
+        model.nextSync();
+    CHECK(pi.getFrequency() != 0);
+
+    CHECK_EQ(pi.reset(), RGBWW_MINTIMEDIFF_US);
+    CHECK_EQ(pi.getFrequency(), 0);
+    CHECK_EQ(pi.getCatchupOffset(), 0);
+    // the first message after a reset only takes the counters
+    CHECK_EQ(pi.onMasterClock(1000, 5000, 0), RGBWW_MINTIMEDIFF_US);
+    CHECK_EQ(pi.getCatchupOffset(), 0);
+}
+
+int main() {
+    testPIDrift();
+    testCatchUpDrift();
+    testPIJump();
+    testReset();
+    return hostTestResult();
+}
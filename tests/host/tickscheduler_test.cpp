@@ -0,0 +1,104 @@
+#include <RGBWWCtrl.h>
+
+#include "hosttest.h"
+
+
+static const uint32_t stepLenMs = 1000 / RGBWW_UPDATEFREQUENCY;
+
+// brings the timeline of the scheduler to nowMs, in chunks below 2^31 ms
+// because deadlines are compared by signed difference
+static void advanceTo(TickScheduler& scheduler, uint32_t nowMs) {
+    const uint32_t chunk = 1u << 30;
+    while (nowMs >= chunk) {
+        scheduler.advance(chunk);
+        nowMs -= chunk;
+    }
+    scheduler.advance(nowMs);
+}
+
+static void testWrapAndIdleTicks() {
+    // the tasks start 5 s before the 32 bit timeline wraps, the ticks span 1
+    // to 4 steps like in idle mode. A task is due exactly in the ticks which
+    // pass a multiple of its interval, also across the wrap: no drift.
+    TickScheduler scheduler;
+    const uint32_t start = 0xffffffffu - 5000 + 1;
+    advanceTo(scheduler, start);
+    scheduler.setInterval(TickScheduler::TaskClockMaster, 1000);
+    scheduler.setInterval(TickScheduler::TaskColorEvent, 100);
+    scheduler.setInterval(TickScheduler::TaskColorMqtt, 0);
+
+    static const uint32_t spans[] = { 1, 3, 2, 1, 4, 5 };
+    uint64_t elapsed = 0;
+    int mismatches = 0;
+    int dueMaster = 0;
+    int dueEvent = 0;
+    int dueMqtt = 0;
+    // 60 rounds of the spans, 19.2 s
+    for(int i = 0; i < 60 * 6; ++i) {
+        const uint64_t prev = elapsed;
+        const uint32_t ms = spans[i % 6] * stepLenMs;
+        elapsed += ms;
+        const uint32_t due = scheduler.advance(ms);
+
+        if (TickScheduler::isSet(due, TickScheduler::TaskClockMaster) != (elapsed / 1000 > prev / 1000))
+            ++mismatches;
+        if (TickScheduler::isSet(due, TickScheduler::TaskColorEvent) != (elapsed / 100 > prev / 100))
+            ++mismatches;
+        if (TickScheduler::isSet(due, TickScheduler::TaskTransitionFinished))
+            ++mismatches;
+        dueMaster += TickScheduler::isSet(due, TickScheduler::TaskClockMaster);
+        dueEvent += TickScheduler::isSet(due, TickScheduler::TaskColorEvent);
+        dueMqtt += TickScheduler::isSet(due, TickScheduler::TaskColorMqtt);
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(elapsed, 19200);
+    CHECK_EQ(dueMaster, 19);
+    CHECK_EQ(dueEvent, 192);
+    // interval 0 runs every tick
+    CHECK_EQ(dueMqtt, 60 * 6);
+}
+
+static void testLongIdleTick() {
+    // a tick over several deadlines runs the task once and restarts its grid
+    TickScheduler scheduler;
+    advanceTo(scheduler, 0xffffffffu - 30);
+    scheduler.setInterval(TickScheduler::TaskColorEvent, 100);
+
+    CHECK_EQ(scheduler.advance(50 * stepLenMs), 1 << TickScheduler::TaskColorEvent);
+    for(int i = 0; i < 4; ++i)
+        CHECK_EQ(scheduler.advance(stepLenMs), 0);
+    CHECK_EQ(scheduler.advance(stepLenMs), 1 << TickScheduler::TaskColorEvent);
+
+    // passing exactly one deadline keeps the grid
+    CHECK_EQ(scheduler.advance(7 * stepLenMs), 1 << TickScheduler::TaskColorEvent);
+    CHECK_EQ(scheduler.advance(3 * stepLenMs), 1 << TickScheduler::TaskColorEvent);
+}
+
+static void testSetInterval() {
+    TickScheduler scheduler;
+    CHECK_EQ(scheduler.advance(0x80000000u), 0);
+    scheduler.setInterval(TickScheduler::TaskClockMaster, 100);
+    CHECK_EQ(scheduler.advance(80), 0);
+
+    // setting the same interval again keeps the deadline
+    scheduler.setInterval(TickScheduler::TaskClockMaster, 100);
+    CHECK_EQ(scheduler.advance(20), 1 << TickScheduler::TaskClockMaster);
+
+    // a changed interval counts from now
+    CHECK_EQ(scheduler.advance(60), 0);
+    scheduler.setInterval(TickScheduler::TaskClockMaster, 60);
+    CHECK_EQ(scheduler.advance(40), 0);
+    CHECK_EQ(scheduler.advance(20), 1 << TickScheduler::TaskClockMaster);
+
+    // a disabled task is never due
+    scheduler.setInterval(TickScheduler::TaskClockMaster, -1);
+    CHECK_EQ(scheduler.advance(0x7fffffffu), 0);
+    CHECK_EQ(scheduler.advance(0x7fffffffu), 0);
+}
+
+int main() {
+    testWrapAndIdleTicks();
+    testLongIdleTick();
+    testSetInterval();
+    return hostTestResult();
+}
@@ -0,0 +1,120 @@
+'''
+Benchmark for the LED render tick (APPLedCtrl::updateLed)
+
+Drives the controller through the HSV fade path, the RAW fade path and the
+publish heavy configurations and reports the statistics collected on the
+device by the tick profiler (/tickstats).
+'''
+import json
+import socket
+import threading
+import time
+
+import requests
+
+#host = "sz-led-wall"
+host = "wz-led-tv"
+
+eventPort = 9090
+numEventClients = 4
+duration = 20
+
+hsvFade = {"hsv": {"h": "{to}", "s": "100", "v": "100", "ct": 0}, "t": 0, "cmd": "fade", "q": "single"}
+rawFade = {"raw": {"r": "{to}", "g": "{to}", "b": "{to}", "ww": "{to}", "cw": "{to}"}, "t": 0, "cmd": "fade", "q": "single"}
+
+
+class EventSink(threading.Thread):
+    '''Connects to the event server and discards everything it receives'''
+
+    def __init__(self):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.received = 0
+        self._running = True
+        self._sock = socket.create_connection((host, eventPort))
+        self._sock.settimeout(1.0)
+
+    def run(self):
+        while self._running:
+            try:
+                data = self._sock.recv(4096)
+            except socket.timeout:
+                continue
+            if not data:
+                break
+            self.received += len(data)
+
+    def stop(self):
+        self._running = False
+        self.join()
+        self._sock.close()
+
+
+def do_request(method, path, data=None):
+    r = requests.request(method, u"http://{}/{}".format(host, path), data=data)
+    if (r.status_code != 200):
+        raise Exception(r.content)
+    return r
+
+
+def get_config():
+    return json.loads(do_request(u"GET", u"config").text)
+
+
+def set_config(cfg):
+    do_request(u"POST", u"config", json.dumps(cfg))
+
+
+def fade(templ, to, ramp_ms):
+    cmd = json.loads(json.dumps(templ).replace("{to}", str(to)))
+    cmd["t"] = ramp_ms
+    do_request(u"POST", u"color", json.dumps(cmd))
+
+
+def measure(name, templ, start, end):
+    fade(templ, start, 0)
+    time.sleep(1)
+
+    do_request(u"POST", u"tickstats")
+    fade(templ, end, duration * 1000)
+    time.sleep(duration)
+    stats = json.loads(do_request(u"GET", u"tickstats").text)
+
+    print u"{:<24} ticks {:>6} | p50 {:>5} us | p90 {:>5} us | p99 {:>5} us | max {:>5} us | jitter max {:>5} us | heap changed {:>5} ticks".format(
+        name, stats["ticks"], stats["p50_us"], stats["p90_us"], stats["p99_us"], stats["max_us"],
+        stats["jitter"]["max_us"], stats["heap"]["changed_ticks"])
+    for stage, values in sorted(stats["stages"].items()):
+        print u"    {:<20} mean {:>5} us | max {:>5} us".format(stage, values["mean_us"], values["max_us"])
+    return stats
+
+
+def main():
+    cfg = get_config()
+    events = cfg["events"]
+    sync = cfg["sync"]
+
+    try:
+        measure(u"hsv fade", hsvFade, 0, 359)
+        measure(u"raw fade", rawFade, 0, 1023)
+
+        set_config({"events": {"color_interval_ms": 0, "color_mininterval_ms": 0},
+                    "sync": {"color_master_enabled": True, "color_master_interval_ms": 0}})
+        sinks = [EventSink() for _ in range(numEventClients)]
+        for sink in sinks:
+            sink.start()
+        try:
+            measure(u"hsv fade (publish)", hsvFade, 0, 359)
+            measure(u"raw fade (publish)", rawFade, 0, 1023)
+        finally:
+            for sink in sinks:
+                sink.stop()
+            print u"event bytes received per client: {}".format([s.received for s in sinks])
+    finally:
+        set_config({"events": {"color_interval_ms": events["color_interval_ms"],
+                               "color_mininterval_ms": events["color_mininterval_ms"]},
+                    "sync": {"color_master_enabled": sync["color_master_enabled"],
+                             "color_master_interval_ms": sync["color_master_interval_ms"]}})
+
+
+if __name__ == "__main__":
+    main()
@@ -252,6 +252,65 @@ class RgbwwTest(unittest.TestCase):
         self.assertAlmostEqual(hue2, 100, delta=delta)  
         self.assertAlmostEqual(sat2, 50, delta=delta)  
         self.assertAlmostEqual(val2, 50, delta=delta)  
+
+    def testBatch(self):
+        cmds = [json.loads(jsonTempl.format(hue=120, val=100, sat=100, time=5000, queue="single", cmd="fade")),
+                json.loads(jsonTempl.format(hue=170, val=100, sat=100, time=5000, queue="back", cmd="fade"))]
+        r = requests.request(u"POST", u"http://{}/color".format(host), data=json.dumps({"cmds": cmds}))
+        self.assertEqual(r.status_code, 200)
+        self.assertEqual(len(json.loads(r.text)["results"]), 2)
+        time.sleep(10)
+
+        self.assertAlmostEqual(get_hue(), 170, delta=0.5)
+
+    def testBatchInvalid(self):
+        '''A batch with an invalid command must not queue anything'''
+        cmds = [json.loads(jsonTempl.format(hue=120, val=100, sat=100, time=5000, queue="single", cmd="fade")),
+                json.loads(jsonTempl.format(hue=170, val=100, sat=100, time=5000, queue="invalid", cmd="fade"))]
+        r = requests.request(u"POST", u"http://{}/color".format(host), data=json.dumps({"cmds": cmds}))
+        self.assertEqual(r.status_code, 400)
+        results = json.loads(r.text)["results"]
+        self.assertTrue(results[0]["success"])
+        self.assertTrue("error" in results[1])
+        time.sleep(6)
+
+        self.assertAlmostEqual(get_hue(), 0, delta=0.5)
+
+    def testAnimation(self):
+        steps = [json.loads(jsonTempl.format(hue=120, val=100, sat=100, time=2000, queue="single", cmd="fade")),
+                 json.loads(jsonTempl.format(hue=170, val=100, sat=100, time=2000, queue="single", cmd="fade")),
+                 {"cmd": "loop", "to": 0, "count": 1}]
+        do_post(u"animation", json.dumps({"name": "test", "steps": steps, "play": "test"}))
+        r = requests.request(u"GET", u"http://{}/animation".format(host))
+        self.assertTrue("test" in json.loads(r.text)["animations"])
+        time.sleep(9)
+
+        self.assertAlmostEqual(get_hue(), 170, delta=0.5)
+        do_post(u"animation", json.dumps({"delete": "test"}))
+
+    def testEaseFade(self):
+        rgbww_set(0, 100, 100)
+        post_data = json.loads(jsonTempl.format(hue=120, val=100, sat=100, time=4000, queue="single", cmd="fade"))
+        post_data["ease"] = "smooth"
+        do_post(u"color", json.dumps(post_data))
+        time.sleep(1)
+        # smoothstep is slower than linear in the first quarter
+        self.assertLess(get_hue(), 30)
+        time.sleep(4)
+
+        self.assertAlmostEqual(get_hue(), 120, delta=0.5)
+
+    def testEaseLogFade(self):
+        rgbww_set(0, 100, 0)
+        post_data = json.loads(jsonTempl.format(hue=0, val=100, sat=100, time=4000, queue="single", cmd="fade"))
+        post_data["ease"] = "log"
+        do_post(u"color", json.dumps(post_data))
+        time.sleep(2)
+        # half way in lightness is well below half of the value
+        self.assertLess(get_val(), 35)
+        time.sleep(3)
+
+        self.assertAlmostEqual(get_val(), 100, delta=0.5)
         
 if __name__ == "__main__":
     #import sys;sys.argv = ['', 'Test.testName']
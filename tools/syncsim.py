@@ -0,0 +1,223 @@
+#!/usr/bin/env python
+"""
+Host side simulator for the clock sync of slaves (app/stepsync.cpp)
+
+A master counts steps of exactly RGBWW_MINTIMEDIFF_US and publishes its step
+counter every --interval seconds. The messages reach the slave after a
+latency with jitter and may get lost. The slave ticks with the interval of
+the controller, off by --drift ppm, and passes its own step counter and the
+one of the master to the controller. The controllers are the ones of the
+firmware, built for the host with the host tests (tests/host/stepsync_pipe).
+
+The error is the phase of the slave against the step grid of the master,
+whole steps are ignored (colors are mapped by the master step counter).
+The controllers only keep the offset seen with the first sync message, so
+without --phase-align the error settles at a bias, the sub-step offset of
+the slave at that time. With --phase-align the slave shifts its next tick
+once per message like APPLedCtrl::onMasterClock, using the phase the
+master sends via UDP. Reported per controller:
+  bias        mean error over the second half of the run
+  converged   time after which |error| stays below --threshold
+  rms / max   of error - bias over the second half of the run
+
+Instead of generated messages a trace of a real master can be replayed with
+--trace, one message per line: "<arrival ms> <master steps> [<phase us>]".
+Jitter and loss are added on top if given.
+
+Examples:
+  syncsim.py --drift 150 --jitter 40 --loss 0.1
+  syncsim.py --outage 600 180 --duration 1800
+  syncsim.py --latency 0.5 --jitter 0.5 --phase-align
+  syncsim.py --trace clock.log --csv out.csv
+"""
+from __future__ import print_function, division
+
+import argparse
+import os
+import random
+import subprocess
+
+BASE_INTERVAL_US = 20000
+HOST_TEST_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tests", "host")
+PIPE_BINARY = os.path.join(HOST_TEST_DIR, "out", "stepsync_pipe")
+
+
+class Controller(object):
+    """a clock controller of the firmware, run by tests/host/stepsync_pipe"""
+
+    def __init__(self, name):
+        self.name = name
+        self.proc = subprocess.Popen([PIPE_BINARY, name], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     universal_newlines=True)
+
+    def _call(self, command):
+        self.proc.stdin.write(command + "\n")
+        self.proc.stdin.flush()
+        return int(self.proc.stdout.readline())
+
+    def reset(self):
+        return self._call("reset")
+
+    def on_master_clock(self, steps, steps_master, phase_error):
+        return self._call("%d %d %d" % (steps & 0xffffffff, steps_master & 0xffffffff, phase_error))
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+CONTROLLERS = ("catchup", "pi")
+
+
+def build_pipe():
+    """builds the controller driver with the host tests"""
+    subprocess.check_call(["make", "-s", "-C", HOST_TEST_DIR, "out/stepsync_pipe"])
+
+
+def generate_messages(args, rnd):
+    """list of (arrival us, master steps, master phase us or None) sorted by arrival"""
+    messages = []
+    if args.trace:
+        with open(args.trace) as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) < 2 or fields[0].startswith("#"):
+                    continue
+                arrival = int(float(fields[0]) * 1000)
+                phase = int(fields[2]) if len(fields) > 2 else None
+                messages.append((arrival, int(fields[1]), phase))
+        base = messages[0][0] if messages else 0
+        messages = [(arrival - base + args.latency * 1000, steps, phase) for arrival, steps, phase in messages]
+    else:
+        interval_us = args.interval * 1000000
+        t = interval_us
+        while t < args.duration * 1000000:
+            latency = args.latency * 1000 + rnd.expovariate(1.0 / (args.jitter * 1000)) if args.jitter > 0 else args.latency * 1000
+            # the master sends from its tick, so right at the start of a step
+            messages.append((t + int(latency), t // BASE_INTERVAL_US, args.master_phase))
+            t += interval_us
+
+    result = []
+    for arrival, steps, phase in messages:
+        if args.loss > 0 and rnd.random() < args.loss:
+            continue
+        if args.outage and args.outage[0] * 1000000 <= arrival < (args.outage[0] + args.outage[1]) * 1000000:
+            continue
+        if args.trace and args.jitter > 0:
+            arrival += int(rnd.expovariate(1.0 / (args.jitter * 1000)))
+        result.append((arrival, steps, phase))
+    result.sort()
+    return result
+
+
+def phase_error(master_phase, local_phase, interval):
+    """sub-step error in us and step correction, see APPLedCtrl::onMasterClock"""
+    error = min(master_phase, interval - 1) - int(local_phase)
+    if error > interval // 2:
+        return error - interval, -1
+    if error <= -(interval // 2):
+        return error + interval, 1
+    return error, 0
+
+
+def simulate(controller, messages, args):
+    """returns a list of (time s, error steps) sampled once per tick"""
+    rate = 1.0 + args.drift / 1e6
+    interval = controller.reset()
+    correction = 0
+    t = args.start_phase * 1000.0
+    steps = 0
+    synced = False
+    samples = []
+    idx = 0
+    end = args.duration * 1e6
+
+    while t < end:
+        tick = (interval + correction) * rate
+        correction = 0
+        # messages arriving during this tick see the current step counter
+        while idx < len(messages) and messages[idx][0] < t + tick:
+            arrival, steps_master, master_phase = messages[idx]
+            idx += 1
+            synced = True
+            local_steps = steps
+            error = 0
+            if args.phase_align and master_phase is not None:
+                error, step = phase_error(master_phase, (arrival - t) / rate, interval)
+                local_steps += step
+                correction = -error
+            interval = controller.on_master_clock(local_steps, steps_master, error)
+            # the same sanity limit as APPLedCtrl::onMasterClock
+            interval = min(max(interval, BASE_INTERVAL_US // 2), BASE_INTERVAL_US * 3 // 2)
+        t += tick
+        steps += 1
+        if synced:
+            # whole steps do not matter, colors are mapped by the master step counter
+            err = t / BASE_INTERVAL_US - steps
+            samples.append((t / 1e6, err - round(err)))
+    return samples
+
+
+def evaluate(samples, args):
+    """returns bias, converged, rms and max, errors in ms"""
+    step_ms = BASE_INTERVAL_US / 1000
+    tail = [err for t, err in samples[len(samples) // 2:]]
+    if not tail:
+        return float("nan"), None, float("nan"), float("nan")
+    bias = sum(tail) / len(tail)
+
+    threshold = args.threshold / step_ms
+    converged = None
+    for t, err in samples:
+        if abs(err) >= threshold:
+            converged = None
+        elif converged is None:
+            converged = t
+
+    rms = (sum((e - bias) ** 2 for e in tail) / len(tail)) ** 0.5
+    return bias * step_ms, converged, rms * step_ms, max(abs(e - bias) for e in tail) * step_ms
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulates the clock sync controllers of slaves")
+    parser.add_argument("--controller", action="append", choices=CONTROLLERS, help="controller to simulate (default: all)")
+    parser.add_argument("--duration", type=float, default=3600, help="simulated time in s")
+    parser.add_argument("--interval", type=int, default=30, help="clock_master_interval in s")
+    parser.add_argument("--drift", type=float, default=100, help="timer error of the slave in ppm")
+    parser.add_argument("--latency", type=float, default=5, help="base latency in ms")
+    parser.add_argument("--jitter", type=float, default=20, help="mean of the exponential jitter in ms")
+    parser.add_argument("--loss", type=float, default=0.0, help="probability of losing a message")
+    parser.add_argument("--outage", type=float, nargs=2, metavar=("START", "LENGTH"), help="lose all messages in this window (s)")
+    parser.add_argument("--start-phase", type=float, default=7, help="sub-step offset of the slave at start in ms")
+    parser.add_argument("--phase-align", action="store_true", help="align the phase with every message (UDP)")
+    parser.add_argument("--master-phase", type=int, default=300, help="phase of the master when sending in us")
+    parser.add_argument("--threshold", type=float, default=5, help="converged if the error stays below (ms)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--trace", help="replay master clock messages from a file")
+    parser.add_argument("--csv", help="write the error of all controllers over time")
+    args = parser.parse_args()
+
+    messages = generate_messages(args, random.Random(args.seed))
+    names = args.controller or CONTROLLERS
+    build_pipe()
+
+    results = {}
+    print("%-8s %10s %12s %10s %10s" % ("", "bias ms", "converged s", "rms ms", "max ms"))
+    for name in names:
+        controller = Controller(name)
+        samples = simulate(controller, messages, args)
+        controller.close()
+        results[name] = samples
+        bias, converged, rms, maxerr = evaluate(samples, args)
+        print("%-8s %10.2f %12s %10.2f %10.2f" % (name, bias, "never" if converged is None else "%.0f" % converged, rms, maxerr))
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("time;" + ";".join(names) + "\n")
+            count = min(len(results[name]) for name in names)
+            for i in range(0, count, 50):
+                f.write("%.2f;" % results[names[0]][i][0] + ";".join("%.3f" % (results[name][i][1] * BASE_INTERVAL_US / 1000) for name in names) + "\n")
+
+
+if __name__ == "__main__":
+    main()